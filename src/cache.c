@@ -0,0 +1,284 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+ *
+ * Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+
+
+
+/****************************************************************
+ * LRU CACHE
+ *
+ * The key of an evaluation is hashed to choose a shard, then a
+ * bucket in the shard. Concurrent evaluations only contend on
+ * the lock of their shard, which is held for the lookup and the
+ * insertion but not while the function is computed.
+ ***************************************************************/
+
+
+
+/* allocates a cache of about capacity entries split among nshards shards */
+wlc_cache *wlc_cache_alloc (size_t capacity, unsigned int nshards) {
+  wlc_cache *cache = (wlc_cache *) malloc (sizeof (wlc_cache));
+  unsigned int s;
+
+  if (nshards==0)
+    nshards = 1;
+
+  cache->nshards = nshards;
+  cache->shards = (cache_shard *) malloc (nshards*sizeof (cache_shard));
+
+  for (s=0; s<nshards; s++) {
+    cache_shard *shard = cache->shards + s;
+    pthread_mutex_init (&shard->lock, NULL);
+    shard->capacity = (capacity + nshards - 1)/nshards;
+    if (shard->capacity==0)
+      shard->capacity = 1;
+    shard->size = 0;
+    shard->entries = (cache_entry *) malloc (shard->capacity*sizeof (cache_entry));
+    shard->nbuckets = 2*shard->capacity;
+    shard->buckets = (cache_entry **) calloc (shard->nbuckets, sizeof (cache_entry *));
+    shard->head = NULL;
+    shard->tail = NULL;
+    shard->hits = 0;
+    shard->misses = 0;
+  }
+
+  return cache;
+}
+
+void wlc_cache_free (wlc_cache *cache) {
+  unsigned int s;
+
+  for (s=0; s<cache->nshards; s++) {
+    pthread_mutex_destroy (&cache->shards [s].lock);
+    free (cache->shards [s].entries);
+    free (cache->shards [s].buckets);
+  }
+
+  free (cache->shards);
+  free (cache);
+}
+
+/* number of evaluations found in the cache and computed, summed over the shards */
+void wlc_cache_stats (wlc_cache *cache, unsigned long *hits, unsigned long *misses) {
+  unsigned int s;
+
+  *hits = 0;
+  *misses = 0;
+
+  for (s=0; s<cache->nshards; s++) {
+    pthread_mutex_lock (&cache->shards [s].lock);
+    *hits += cache->shards [s].hits;
+    *misses += cache->shards [s].misses;
+    pthread_mutex_unlock (&cache->shards [s].lock);
+  }
+}
+
+/* builds the key from the function and the bits of its arguments */
+static void cache_key (uint64_t *key, enum cache_function func, const double *args, size_t nargs) {
+  size_t i;
+
+  memset (key, 0, CACHE_KEY_SIZE*sizeof (uint64_t));
+  key [0] = func;
+  for (i=0; i<nargs; i++)
+    memcpy (key + i + 1, args + i, sizeof (uint64_t));
+}
+
+/* 64 bits hash of a key (FNV-1a over the words, followed by a final mixing) */
+static uint64_t cache_hash (const uint64_t *key) {
+  uint64_t h = 14695981039346656037ULL;
+  size_t i;
+
+  for (i=0; i<CACHE_KEY_SIZE; i++) {
+    h ^= key [i];
+    h *= 1099511628211ULL;
+  }
+
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+
+  return h;
+}
+
+/* removes an entry from the list of recently used entries */
+static void cache_unlink (cache_shard *shard, cache_entry *e) {
+  if (e->prev)
+    e->prev->next = e->next;
+  else
+    shard->head = e->next;
+
+  if (e->next)
+    e->next->prev = e->prev;
+  else
+    shard->tail = e->prev;
+}
+
+/* puts an entry at the head of the list of recently used entries */
+static void cache_push_front (cache_shard *shard, cache_entry *e) {
+  e->prev = NULL;
+  e->next = shard->head;
+
+  if (shard->head)
+    shard->head->prev = e;
+  else
+    shard->tail = e;
+
+  shard->head = e;
+}
+
+/* looks for the key in the bucket, locked by the caller */
+static cache_entry *cache_find (cache_shard *shard, size_t b, const uint64_t *key) {
+  cache_entry *e;
+
+  for (e=shard->buckets [b]; e; e=e->chain)
+    if (memcmp (e->key, key, CACHE_KEY_SIZE*sizeof (uint64_t))==0)
+      return e;
+
+  return NULL;
+}
+
+/* copies the value of the key into value and returns 1 if it is in the cache, returns 0 otherwise */
+static int cache_lookup (wlc_cache *cache, const uint64_t *key, double *value) {
+  uint64_t h = cache_hash (key);
+  cache_shard *shard = cache->shards + h%cache->nshards;
+  size_t b = (h/cache->nshards)%shard->nbuckets;
+  cache_entry *e;
+
+  pthread_mutex_lock (&shard->lock);
+
+  e = cache_find (shard, b, key);
+
+  if (e) {
+    cache_unlink (shard, e);
+    cache_push_front (shard, e);
+    memcpy (value, e->value, CACHE_VALUE_SIZE*sizeof (double));
+    shard->hits++;
+  }
+  else
+    shard->misses++;
+
+  pthread_mutex_unlock (&shard->lock);
+
+  return e!=NULL;
+}
+
+/* stores the value of the key, replacing the least recently used entry of the shard if full */
+static void cache_insert (wlc_cache *cache, const uint64_t *key, const double *value) {
+  uint64_t h = cache_hash (key);
+  cache_shard *shard = cache->shards + h%cache->nshards;
+  size_t b = (h/cache->nshards)%shard->nbuckets;
+  cache_entry *e, **p;
+
+  pthread_mutex_lock (&shard->lock);
+
+  /* another thread may have computed the same key meanwhile */
+  e = cache_find (shard, b, key);
+
+  if (e)
+    cache_unlink (shard, e);
+  else {
+    if (shard->size<shard->capacity)
+      e = shard->entries + shard->size++;
+    else {
+      /* evict the least recently used entry */
+      uint64_t he;
+      e = shard->tail;
+      cache_unlink (shard, e);
+      he = cache_hash (e->key);
+      for (p=shard->buckets + (he/cache->nshards)%shard->nbuckets; *p!=e; p=&(*p)->chain);
+      *p = e->chain;
+    }
+
+    memcpy (e->key, key, CACHE_KEY_SIZE*sizeof (uint64_t));
+    e->chain = shard->buckets [b];
+    shard->buckets [b] = e;
+  }
+
+  memcpy (e->value, value, CACHE_VALUE_SIZE*sizeof (double));
+  cache_push_front (shard, e);
+
+  pthread_mutex_unlock (&shard->lock);
+}
+
+
+
+/****************************************************************
+ * CACHED FUNCTIONS
+ ***************************************************************/
+
+
+
+/* wlc_rho_F_cavity through the cache */
+double wlc_rho_F_cavity_cached (wlc_cache *cache, double f, double bB, double JB) {
+  double args [3], value [CACHE_VALUE_SIZE] = {0.};
+  uint64_t key [CACHE_KEY_SIZE];
+
+  args [0] = f;
+  args [1] = bB;
+  args [2] = JB;
+  cache_key (key, CACHE_RHO_F_CAVITY, args, 3);
+
+  if (!cache_lookup (cache, key, value)) {
+    value [0] = wlc_rho_F_cavity (f, bB, JB);
+    cache_insert (cache, key, value);
+  }
+
+  return value [0];
+}
+
+/* wlc_rho_F_cavity_and_gradient through the cache */
+double wlc_rho_F_cavity_and_gradient_cached (wlc_cache *cache, double f, double bB, double JB, double *drho_dbB, double *drho_dJB, double *xi) {
+  double args [3], value [CACHE_VALUE_SIZE] = {0.};
+  uint64_t key [CACHE_KEY_SIZE];
+
+  args [0] = f;
+  args [1] = bB;
+  args [2] = JB;
+  cache_key (key, CACHE_RHO_F_CAVITY_AND_GRADIENT, args, 3);
+
+  if (!cache_lookup (cache, key, value)) {
+    value [0] = wlc_rho_F_cavity_and_gradient (f, bB, JB, value + 1, value + 2, value + 3);
+    cache_insert (cache, key, value);
+  }
+
+  *drho_dbB = value [1];
+  *drho_dJB = value [2];
+  *xi = value [3];
+
+  return value [0];
+}
+
+/* wlc_F_rho through the cache */
+double wlc_F_rho_cached (wlc_cache *cache, double rho, double lpb) {
+  double args [2], value [CACHE_VALUE_SIZE] = {0.};
+  uint64_t key [CACHE_KEY_SIZE];
+
+  args [0] = rho;
+  args [1] = lpb;
+  cache_key (key, CACHE_F_RHO, args, 2);
+
+  if (!cache_lookup (cache, key, value)) {
+    value [0] = wlc_F_rho (rho, lpb);
+    cache_insert (cache, key, value);
+  }
+
+  return value [0];
+}
@@ -0,0 +1,66 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+ *
+ * Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WLC_CACHE_H__
+#define __WLC_CACHE_H__
+
+#include <stdint.h>
+#include <pthread.h>
+#include "wlc.h"
+
+/* a key is the function cached followed by the bits of its arguments, */
+/* a value is the result followed by the other outputs of the function */
+#define CACHE_KEY_SIZE 4
+#define CACHE_VALUE_SIZE 4
+
+/* functions that can be cached */
+enum cache_function {
+  CACHE_RHO_F_CAVITY = 1,
+  CACHE_RHO_F_CAVITY_AND_GRADIENT,
+  CACHE_F_RHO
+};
+
+typedef struct cache_entry {
+  uint64_t key [CACHE_KEY_SIZE];
+  double value [CACHE_VALUE_SIZE];
+  struct cache_entry *chain;   /* next entry in the same bucket */
+  struct cache_entry *prev;    /* more recently used entry */
+  struct cache_entry *next;    /* less recently used entry */
+} cache_entry;
+
+/* each shard is an independent LRU cache with its own lock, */
+/* a hash table of buckets and a list of entries from the most to the least recently used */
+typedef struct cache_shard {
+  pthread_mutex_t lock;
+  size_t capacity;
+  size_t size;
+  cache_entry *entries;
+  size_t nbuckets;
+  cache_entry **buckets;
+  cache_entry *head;
+  cache_entry *tail;
+  unsigned long hits;
+  unsigned long misses;
+} cache_shard;
+
+struct wlc_cache {
+  unsigned int nshards;
+  cache_shard *shards;
+};
+
+#endif
@@ -18,12 +18,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <gsl/gsl_cblas.h>
+#include <gsl/gsl_errno.h>
 #include "cavity_macros.h"
 #include "cavity.h"
 #include "cavity_alloc.h"
 #include "cavity_init.h"
 #include "cavity_scalar.h"
 #include "cavity_integrate.h"
+#include "cavity_kernel.h"
 
 /******************************************************************
  *                                                                *
@@ -38,59 +41,195 @@
  *                                                                *
  *****************************************************************/
 
-/* integrate exp(J * t * u) * P_c (u) over u (i.e. angles theta and phi) */
+/* integrate exp(J * t * u) * P_c (u) over u (i.e. angles theta and phi) for all values of t */
 /* integral in Eq. (9) of Massucci et al. 2014 */
-double cavity_integrate_marginal (cavity_workspace *cav_w, double *p_c, double JB, int INIT) {
+/* the quadrature weights and the Boltzmann factor are stored in the kernel, so that the */
+/* integrals for the whole grid are obtained with a single matrix-vector product */
+/* in single precision mode, the product is done in single precision on a copy of the marginal */
+void cavity_integrate_marginal (cavity_workspace *cav_w, const double *p_c, double *integral) {
     
-    double *s, integral=0.;
-    int i=0;
+    int i;
     
-    for (s=cav_w -> scalar_prod+INIT; s<cav_w -> scalar_prod+INIT+__Ntheta__*__Nphi__; s++){
+    if (cav_w -> single){
         
-        /* weights fort theta and phi are stored in w_theta and w_phi, respectively */
-        /* i/__Nphi__ gives the (index of) angle theta and i%__Nphi__ the one of phi */
-        integral += *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__) *exp(*s*JB) * *(p_c + i);
+        for (i=0; i<cav_w -> npoints; i++)
+            *(cav_w -> marginal_single + i) = (float) *(p_c + i);
         
-        i++;
+        cavity_kernel_product_single (cav_w -> kernel_single, cav_w -> marginal_single, cav_w -> integral_single, cav_w -> npoints);
         
+        for (i=0; i<cav_w -> npoints; i++)
+            *(integral + i) = *(cav_w -> integral_single + i);
     }
+    else if (cav_w -> spectral)
+        cavity_spectral_product (cav_w -> spectral, p_c, integral);
+    else if (cav_w -> fft)
+        cavity_fft_product (cav_w -> fft, p_c, integral);
+    else if (cav_w -> lean)
+        cavity_kernel_product_lean (cav_w -> lean, cav_w -> cos_theta, cav_w -> sin_theta, cav_w -> cos_dphi, cav_w -> weight, cav_w -> JB, p_c, integral, cav_w -> Ntheta, cav_w -> Nphi);
+    else
+        cavity_kernel_product (cav_w -> kernel, p_c, 0., integral, cav_w -> npoints);
+}
+    
     
-    return integral;
+/* compute the Boltzmann kernel for the given JB */
+/* the kernel only depends on JB, and is kept from the previous call if JB did not change; */
+/* in lean mode, it is computed during each product with the JB stored here */
+void cavity_update_kernel (cavity_workspace *cav_w, double JB){
+    
+    size_t i;
+    
+    if (!cav_w -> kernel_ready || cav_w -> JB != JB){
+        
+        if (cav_w -> spectral)
+            cavity_spectral_compute_kernel (cav_w -> spectral, JB);
+        else if (cav_w -> axisymmetric){
+            
+            cavity_compute_kernel_axisymmetric (cav_w -> kernel, cav_w -> cos_theta, cav_w -> weight, JB, cav_w -> Ntheta);
+            
+            if (cav_w -> single)
+                for (i=0; i<(size_t) cav_w -> npoints*cav_w -> npoints; i++)
+                    *(cav_w -> kernel_single + i) = (float) *(cav_w -> kernel + i);
+        }
+        else if (cav_w -> fft)
+            cavity_fft_compute_kernel (cav_w -> fft, cav_w -> cos_theta, cav_w -> w_cos_theta, JB);
+        else if (cav_w -> single)
+            cavity_compute_kernel_single (cav_w -> kernel_single, cav_w -> scalar_prod, cav_w -> weight, JB, cav_w -> npoints);
+        else if (!cav_w -> lean)
+            cavity_compute_kernel (cav_w -> kernel, cav_w -> scalar_prod, cav_w -> weight, JB, cav_w -> npoints);
+        
+        cav_w -> JB = JB;
+        cav_w -> kernel_ready = 1;
+    }
 }
+
+/* rate of convergence of a sequence from its last two changes d_old, d, or __RATE_MAX__ if it does not decrease */
+static double cavity_rate (double d, double d_old){
     
+    return d < d_old ? fmin (d/d_old, __RATE_MAX__) : __RATE_MAX__;
+}
+
+/* error of rho and of Z after a sweep of the iteration, i.e. their distance to the fixed point, estimated */
+/* as their change (relative for Z) divided by 1 - r, r being the rate of convergence of the sequence. */
+/* history holds rho and Z after the previous sweep and their changes, and is updated; its four values */
+/* are set to HUGE_VAL before the first sweep */
+double cavity_observables_error (double rho, double Z, double *history){
+    
+    double d_rho = fabs(rho-*history), d_Z = fabs(Z-*(history+2))/Z, error;
     
+    /* nothing is measured by the first sweep: its changes are stored as 0, so that the rate of the second */
+    /* sweep is __RATE_MAX__, and convergence is only accepted once a rate has been measured */
+    if (*history == HUGE_VAL){
+        
+        *history = rho;
+        *(history+1) = 0.;
+        *(history+2) = Z;
+        *(history+3) = 0.;
+        
+        return HUGE_VAL;
+    }
+    
+    error = fmax (d_rho/(1.-cavity_rate (d_rho, *(history+1))), d_Z/(1.-cavity_rate (d_Z, *(history+3))));
+    
+    *history = rho;
+    *(history+1) = d_rho;
+    *(history+2) = Z;
+    *(history+3) = d_Z;
+    
+    return error;
+}
+
 /* iterate Eq. (9) of Massucci et al. 2014 */
-void cavity_iterate_marginal_equations (cavity_workspace *cav_w, double f, double bB, double JB){
+int cavity_iterate_marginal_equations (cavity_workspace *cav_w, double f, double bB, double JB){
     
 
     int i;
-    double error, *P, *p1, *p2, Z, integral;
+    unsigned int iter=0;
+    double error, *P, *p1, *p2, Z, integral, dZ, rho, Z_rho, history[4]={HUGE_VAL, HUGE_VAL, HUGE_VAL, HUGE_VAL};
+    
+    /* the change of the marginal is tested unless only the observables are */
+    int weighted = cav_w -> criterion & WLC_CAVITY_WEIGHTED;
+    int observables = cav_w -> criterion & WLC_CAVITY_OBSERVABLES;
+    int marginal = weighted || !observables;
+    
+    /* on an adaptive grid, the points in cos(theta) follow the force */
+    cavity_stretch_grid (cav_w, f, bB);
+    
+    /* instead of the uniform marginal, start from the one converged on the coarser grid, */
+    /* itself started from the next coarser one, and interpolated to this grid; if the coarse */
+    /* iteration did not converge, or the interpolation is not strictly positive, the iteration */
+    /* starts from the uniform marginal */
+    if (cav_w -> coarse && cav_w -> uniform){
+        
+        cavity_initialise_marginal (cav_w -> coarse);
+        
+        if (cavity_iterate_marginal_equations (cav_w -> coarse, f, bB, JB)==GSL_SUCCESS){
+            
+            cavity_multigrid_prolong (cav_w -> prolong_theta, cav_w -> prolong_phi, cav_w -> coarse -> marginal, cav_w -> coarse -> Ntheta, cav_w -> coarse -> Nphi, cav_w -> marginal, cav_w -> Ntheta, cav_w -> Nphi, cav_w -> marginal_dummy);
+            
+            for (i=0; i<cav_w -> npoints && *(cav_w -> marginal + i) > 0.; i++);
+        }
+        else
+            i = 0;
+        
+        if (i < cav_w -> npoints)
+            cavity_initialise_marginal (cav_w);
+    }
+    
+    cav_w -> uniform = 0;
+    
+    /* the Boltzmann kernel and the field factor do not change during the iteration: compute them once */
+    cavity_update_kernel (cav_w, JB);
+    
+    cav_w -> log_scale = fabs(JB) + cavity_compute_field (cav_w -> field, cav_w -> cos_theta, f, bB, cav_w -> Ntheta, cav_w -> Nphi);
+    
+    /* the eigen-solver obtains the fixed point directly, starting from the current marginal */
+    if (cav_w -> eigen)
+        return cavity_eigen_marginal (cav_w -> eigen, cav_w -> kernel, cav_w -> field, cav_w -> weight, cav_w -> tol, cav_w -> max_iter, cav_w -> marginal, &cav_w -> lambda, &cav_w -> iter);
     
     /* The equations are iterated recursively. 2 arrays for the cavity marginal are used and swapped at each iteration */
     p1 = cav_w-> marginal;
     p2 = cav_w-> marginal_dummy;
     
+    /* the history of the accelerated iteration belongs to the previous call */
+    if (cav_w -> anderson)
+        cavity_anderson_reset (cav_w -> anderson);
+    
         
     
     do {
         
-        /* initialise the normalising factor and its derivative with respect to b_B and J_B */
+        iter++;
+        
+        /* Perform the integrals of the cavity equations using Gaussian quadratures */
+        cavity_integrate_marginal (cav_w, p1, p2);
+        
+        /* initialise the normalising factor */
         Z=0.;
+        rho=0.;
+        Z_rho=0.;
         i=0;
         
         /* The cavity marginal depends on angles theta and phi */
         /* It is discretised in Ntheta x Nphi points */
             
-        for(P = p2; P<p2+__Ntheta__*__Nphi__;P++){
+        for(P = p2; P<p2+cav_w -> npoints;P++){
             
-            /* Perform the integrals of the cavity equations using Gaussian quadratures */
-            integral = cavity_integrate_marginal (cav_w, p1, JB, i*__Ntheta__*__Nphi__);
+            integral = *P;
             
             /* P = exp (b_B * f * z*t) * Integral(t) */
-            *P = exp(f* *(cav_w -> cos_theta+ i/__Nphi__)*bB)*integral;
+            *P *= *(cav_w -> field + i);
             
             /* increase the normalization */
-            Z += *P * *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__);
+            Z += *P * *(cav_w -> weight + i);
+            
+            /* the elongation of the current marginal, as in wlc_rho_F_cavity_workspace */
+            if (observables){
+                
+                dZ = *P * integral * *(cav_w -> weight + i);
+                
+                rho += *(cav_w -> cos_theta+ i/cav_w -> Nphi) * dZ;
+                Z_rho += dZ;
+            }
             
             i++;
         }
@@ -100,16 +239,27 @@ void cavity_iterate_marginal_equations (cavity_workspace *cav_w, double f, doubl
 
         i = 0;
         
-        for(P = p2; P<p2+__Ntheta__*__Nphi__;P++){
+        for(P = p2; P<p2+cav_w -> npoints;P++){
             
             *P /= Z;
             
-            error+=fabs(*P-*(p1+i));
+            if (weighted)
+                error+=fabs(*P-*(p1+i)) * *(cav_w -> weight + i);
+            else if (marginal)
+                error+=fabs(*P-*(p1+i));
             
             i++;
             
         }
         
+        /* the error of rho and of the normalisation */
+        if (observables)
+            error = fmax (error, cavity_observables_error (rho/Z_rho, Z, history));
+        
+        /* accelerate the iteration by mixing the new marginal with the previous iterations */
+        if (cav_w -> anderson && error>cav_w -> tol)
+            cavity_anderson_mix (cav_w -> anderson, &p1, &p2);
+        
         /* swap p1, p2 for further iteration */
         P = p2;
         
@@ -120,5 +270,16 @@ void cavity_iterate_marginal_equations (cavity_workspace *cav_w, double f, doubl
         }
         
         /* repeat until convergence */
-        while(error>__TOL__);
+        while(error>cav_w -> tol && iter<cav_w -> max_iter);
+    
+    /* keep the last iterate in the marginal, to be used for the observables */
+    /* and as the starting point of a following call (e.g. at a nearby force) */
+    cav_w -> marginal = p1;
+    cav_w -> marginal_dummy = p2;
+    
+    cav_w -> iter = iter;
+    cav_w -> lambda = Z;
+    
+    /* signal if the iteration stopped before reaching convergence */
+    return error>cav_w -> tol ? GSL_CONTINUE : GSL_SUCCESS;
 }
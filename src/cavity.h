@@ -19,9 +19,70 @@
 #define __CAVITY_LIB_H__
 
 #include "cavity_macros.h"
+#include "wlc.h"
+#include "cavity_anderson.h"
+#include "cavity_eigen.h"
+#include "cavity_block.h"
+#include "cavity_fft.h"
+#include "cavity_spectral.h"
+#include "cavity_lebedev.h"
+#include "cavity_multigrid.h"
+#include "cavity_kernel.h"
 
 /* a workspace structure to handle all memory needed by the cavity routines */
-typedef struct{
+typedef struct cavity_workspace{
+    
+    /* size of the grid on which the marginal is discretised: Ntheta x Nphi = npoints */
+    /* an axisymmetric marginal does not depend on phi and is discretised on Ntheta x 1 points */
+    int Ntheta;
+    int Nphi;
+    int npoints;
+    int axisymmetric;
+    
+    /* a periodic grid is uniform in phi (trapezoidal rule) instead of Gauss-Legendre */
+    int periodic;
+    
+    /* a Lebedev grid is an unstructured list of npoints = Ntheta points on the sphere, with Nphi = 1: */
+    /* the point i has its own cos(theta), phi and weight in cos_theta, phi and w_cos_theta */
+    int lebedev;
+    
+    /* on an adaptive grid, the points in cos(theta) are stretched towards the force axis by a */
+    /* parameter that depends on f*bB (see stretch_parameter); stretch is its current value */
+    int adaptive;
+    double stretch;
+    
+    /* tolerance and maximum number of iterations of the cavity equations, and the convergence test */
+    /* (a combination of WLC_CAVITY_WEIGHTED and WLC_CAVITY_OBSERVABLES, see wlc_cavity_params) */
+    double tol;
+    unsigned int max_iter;
+    int criterion;
+    
+    /* value of JB for which the kernel has been computed, if kernel_ready is set */
+    double JB;
+    int kernel_ready;
+    
+    /* number of iterations done by the last call to the iteration routine, and its status */
+    unsigned int iter;
+    int status;
+    
+    /* history for the Anderson acceleration, NULL for the plain iteration */
+    cavity_anderson *anderson;
+    
+    /* eigen-solver of the cavity equations, NULL for the iteration */
+    cavity_eigen *eigen;
+    
+    /* marginals of a block of forces iterated together, NULL to iterate one force at a time */
+    cavity_block *block;
+    
+    /* normalisation of the marginal at the fixed point, i.e. the leading eigenvalue of the transfer operator */
+    double lambda;
+    
+    /* variance of z*t at the last force evaluated */
+    double variance;
+    
+    /* the kernel and the field are scaled by exp(-log_scale), log_scale = |JB| + |b_B f| z_max, so that */
+    /* they are at most 1 whatever JB and f: the eigenvalue of the unscaled operator is lambda exp(log_scale) */
+    double log_scale;
     
     /* arrays for 2 cavity marginals to be iterated*/
     double *marginal;
@@ -38,13 +99,61 @@ typedef struct{
     /*arrays for scalar product values */
     double *scalar_prod;
     
+    /*array for the quadrature weight of each grid point */
+    double *weight;
+    
+    /*array for the Boltzmann kernel w(u) * exp(J * t*u) */
+    double *kernel;
+    
+    /* in single precision mode, the kernel is stored in single precision, and the products with it */
+    /* are done on single precision copies of the marginal and of the integrals; all the other */
+    /* quantities, and in particular the sums over the grid, are kept in double precision */
+    int single;
+    float *kernel_single;
+    float *marginal_single;
+    float *integral_single;
+    
+    /* in lean mode, neither the scalar products nor the kernel are stored: the scalar product */
+    /* t*u = cos(theta)cos(theta') + sin(theta)sin(theta') cos(phi-phi') is rebuilt from sin(theta) */
+    /* and cos(phi-phi'), and the kernel is computed by tiles during each product, in the buffers */
+    /* of lean; NULL when the kernel is stored */
+    cavity_lean *lean;
+    double *sin_theta;
+    double *cos_dphi;
+    
+    /* on a periodic grid, the products with the kernel are done by FFT in phi, NULL otherwise */
+    cavity_fft *fft;
+    
+    /* in the spectral mode, the products with the axisymmetric kernel are done in a Legendre basis, NULL otherwise */
+    cavity_spectral *spectral;
+    
+    /*array for the external field factor exp(b_B * f * z*t) */
+    double *field;
+    
+    /*array for the integrals of the kernel times the marginal */
+    double *integral;
+    
+    /* workspace of the grid with half the points in cos(theta) and phi, on which the iteration */
+    /* starts when the marginal is uniform (set by cavity_initialise_marginal), NULL on the coarsest grid; */
+    /* the marginal converged there is interpolated to this grid by prolong_theta and prolong_phi */
+    struct cavity_workspace *coarse;
+    int uniform;
+    double *prolong_theta;
+    double *prolong_phi;
+    
 } cavity_workspace;
 
 #include "cavity_alloc.h"
 #include "cavity_init.h"
 
-double cavity_integrate_marginal (cavity_workspace *, double *, double, int);
+void cavity_integrate_marginal (cavity_workspace *, const double *, double *);
+
+void cavity_update_kernel (cavity_workspace *, double);
+
+double cavity_observables_error (double, double, double *);
+
+int cavity_iterate_marginal_equations (cavity_workspace *, double, double, double);
 
-void cavity_iterate_marginal_equations (cavity_workspace *, double, double, double);
+int cavity_iterate_marginal_block (cavity_workspace *, const double *, int, double, double);
 
 #endif
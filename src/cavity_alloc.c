@@ -15,33 +15,164 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <gsl/gsl_errno.h>
 #include "cavity_alloc.h"
 
-/* allocate the memory for the cavity workspace */
-cavity_workspace *cavity_workspace_alloc (void){
+/* the parameters are set at run time: reject those for which the iteration is not defined, on a grid of */
+/* Ntheta x Nphi points that is a Lebedev grid if lebedev is set. caller names the allocator in the messages */
+void cavity_check_params (const char *caller, const wlc_cavity_params *params, int lebedev, int Ntheta, int Nphi){
+    
+    if (lebedev && cavity_lebedev_degree (params -> lebedev) < 0){
+        
+        wlc_error ("%s: no Lebedev grid with %d points\n", caller, params -> lebedev);
+        exit (EXIT_FAILURE);
+    }
+    
+    if (Ntheta < 1 || Nphi < 1){
+        
+        wlc_error ("%s: the grid needs at least one point in cos(theta) and phi (Ntheta = %d, Nphi = %d)\n", caller, params -> Ntheta, params -> Nphi);
+        exit (EXIT_FAILURE);
+    }
+    
+    if (!(params -> tol > 0.) || params -> max_iter == 0){
+        
+        wlc_error ("%s: the tolerance and the maximum number of iterations must be positive (tol = %g, max_iter = %u)\n", caller, params -> tol, params -> max_iter);
+        exit (EXIT_FAILURE);
+    }
+}
+
+/* report an option of wlc_cavity_params that was requested but is not used, being overridden by another one */
+void cavity_report_dropped (const char *caller, const char *option, int requested, int used, const char *reason){
+    
+    if (requested && !used)
+        wlc_error ("%s: %s is ignored %s\n", caller, option, reason);
+}
+
+/* allocate the memory for the cavity workspace, reporting the options overridden by others if report is set */
+/* (the coarser grids have the same options, which are only reported for the finest one) */
+static cavity_workspace *cavity_workspace_alloc_grid (const wlc_cavity_params *params, int report){
     cavity_workspace *cav_wspace;
+    wlc_cavity_params coarse_params;
     
     cav_wspace = (cavity_workspace *) malloc (sizeof(cavity_workspace));
     
+    /* set the size of the grid and the parameters of the iteration */
+    /* an axisymmetric marginal is discretised on a single point in phi, as is the spectral one */
+    cav_wspace -> axisymmetric = params -> axisymmetric || params -> spectral;
+    
+    /* a Lebedev grid replaces the tensor grid of a marginal that depends on phi */
+    cav_wspace -> lebedev = params -> lebedev && !cav_wspace -> axisymmetric;
+    
+    cav_wspace -> Ntheta = cav_wspace -> lebedev ? params -> lebedev : params -> Ntheta;
+    cav_wspace -> Nphi = cav_wspace -> axisymmetric || cav_wspace -> lebedev ? 1 : params -> Nphi;
+    cav_wspace -> npoints = cav_wspace -> Ntheta * cav_wspace -> Nphi;
+    
+    cavity_check_params ("cavity_workspace_alloc", params, cav_wspace -> lebedev, cav_wspace -> Ntheta, cav_wspace -> Nphi);
+    
+    cav_wspace -> periodic = params -> periodic && !cav_wspace -> axisymmetric && !cav_wspace -> lebedev;
+    
+    cav_wspace -> tol = params -> tol;
+    cav_wspace -> max_iter = params -> max_iter;
+    cav_wspace -> criterion = params -> criterion;
+    cav_wspace -> status = GSL_SUCCESS;
+    
+    /* the Anderson acceleration mixes the marginal, which the eigen-solver does not iterate */
+    cav_wspace -> anderson = params -> anderson && !params -> eigen ? cavity_anderson_alloc (cav_wspace -> npoints, 1, params -> anderson) : NULL;
+    
+    /* the eigen-solver replaces the iteration of the marginal */
+    cav_wspace -> eigen = params -> eigen ? cavity_eigen_alloc (cav_wspace -> npoints) : NULL;
+    
+    /* the forces of a curve are iterated together by the plain iteration only */
+    cav_wspace -> block = params -> block > 1 && !params -> eigen && !params -> anderson ? cavity_block_alloc (cav_wspace -> npoints, params -> block) : NULL;
+    
+    /* the grid in cos(theta) of the spectral products is fixed, and the forces of a block share their grid */
+    cav_wspace -> adaptive = params -> adaptive && !params -> spectral && !cav_wspace -> lebedev && !cav_wspace -> block;
+    
+    /* the spectral products are only used by the iteration of one force at a time */
+    cav_wspace -> spectral = params -> spectral && !cav_wspace -> eigen && !cav_wspace -> block ? cavity_spectral_alloc (cav_wspace -> Ntheta) : NULL;
+    
+    /* the products by FFT are only used by the iteration of one force at a time */
+    cav_wspace -> fft = cav_wspace -> periodic && !cav_wspace -> eigen && !cav_wspace -> block ? cavity_fft_alloc (cav_wspace -> Ntheta, cav_wspace -> Nphi) : NULL;
+    
+    /* the kernel computed on the fly is only used by the iteration of one force at a time; */
+    /* the axisymmetric kernel is small enough to be stored */
+    cav_wspace -> lean = params -> lean && !cav_wspace -> axisymmetric && !cav_wspace -> lebedev && !cav_wspace -> eigen && !cav_wspace -> block && !cav_wspace -> fft ? cavity_lean_alloc (cav_wspace -> Ntheta, cav_wspace -> Nphi) : NULL;
+    
+    /* the single precision kernel is only used by the iteration of one force at a time */
+    cav_wspace -> single = params -> single && !cav_wspace -> eigen && !cav_wspace -> block && !cav_wspace -> lean && !cav_wspace -> fft && !cav_wspace -> spectral;
+    
     /* allocate space for the cavity marginals to iterate */
-    cav_wspace -> marginal = __ALLOC_MARGINAL__;
-    cav_wspace -> marginal_dummy = __ALLOC_MARGINAL__;
+    cav_wspace -> marginal = __ALLOC_MARGINAL__(cav_wspace);
+    cav_wspace -> marginal_dummy = __ALLOC_MARGINAL__(cav_wspace);
     
     /* allocate cos(theta) and weights for the Gauss-Leg integration */
-    cav_wspace -> cos_theta = __ALLOC_COS_THETA__;
+    cav_wspace -> cos_theta = __ALLOC_COS_THETA__(cav_wspace);
     
-    cav_wspace -> w_cos_theta = __ALLOC_COS_THETA__;
+    cav_wspace -> w_cos_theta = __ALLOC_COS_THETA__(cav_wspace);
     
     /* allocate phi and weights for the Gauss-Leg integration */
-    cav_wspace -> phi = __ALLOC_PHI__;
-    cav_wspace -> w_phi = __ALLOC_PHI__;
+    cav_wspace -> phi = cav_wspace -> lebedev ? __ALLOC_COS_THETA__(cav_wspace) : __ALLOC_PHI__(cav_wspace);
+    cav_wspace -> w_phi = __ALLOC_PHI__(cav_wspace);
+    
+    /* allocate memory for the scalar product, which the axisymmetric and the lean kernels do not need */
+    cav_wspace -> scalar_prod = cav_wspace -> axisymmetric || cav_wspace -> lean || cav_wspace -> fft ? NULL : __ALLOC_SCALAR_PRODUCT__(cav_wspace);
+    
+    cav_wspace -> sin_theta = cav_wspace -> lean ? __ALLOC_COS_THETA__(cav_wspace) : NULL;
+    cav_wspace -> cos_dphi = cav_wspace -> lean ? __ALLOC_COS_DPHI__(cav_wspace) : NULL;
     
-    /* allocate memory for the scalar product */
-    cav_wspace -> scalar_prod = __ALLOC_SCALAR_PRODUCT__;
+    /* allocate the quadrature weights and the field factor on the grid */
+    cav_wspace -> weight = __ALLOC_MARGINAL__(cav_wspace);
+    cav_wspace -> field = __ALLOC_MARGINAL__(cav_wspace);
+    
+    /* allocate memory for the Boltzmann kernel; in single precision, the double precision */
+    /* kernel is only needed to build the axisymmetric one, and in lean, FFT and spectral modes it is not stored */
+    cav_wspace -> kernel = (cav_wspace -> single && !cav_wspace -> axisymmetric) || cav_wspace -> lean || cav_wspace -> fft || cav_wspace -> spectral ? NULL : __ALLOC_KERNEL__(cav_wspace);
+    
+    cav_wspace -> kernel_single = cav_wspace -> single ? __ALLOC_KERNEL_SINGLE__(cav_wspace) : NULL;
+    cav_wspace -> marginal_single = cav_wspace -> single ? __ALLOC_MARGINAL_SINGLE__(cav_wspace) : NULL;
+    cav_wspace -> integral_single = cav_wspace -> single ? __ALLOC_MARGINAL_SINGLE__(cav_wspace) : NULL;
+    
+    /* allocate the integrals of the kernel */
+    cav_wspace -> integral = __ALLOC_MARGINAL__(cav_wspace);
+    
+    /* the coarser grids have half the points in cos(theta) and phi, with the same solver: */
+    /* they are not used by the unstructured, adaptive and block grids, whose marginal is not */
+    /* started from the uniform one or not interpolated in cos(theta) and phi */
+    coarse_params = *params;
+    coarse_params.Ntheta = (params -> Ntheta+1)/2;
+    coarse_params.Nphi = (params -> Nphi+1)/2;
+    coarse_params.multigrid = params -> multigrid-1;
+    
+    cav_wspace -> coarse = params -> multigrid && !cav_wspace -> lebedev && !cav_wspace -> adaptive && !cav_wspace -> block
+        && coarse_params.Ntheta >= __MULTIGRID_MIN__ && (cav_wspace -> axisymmetric || coarse_params.Nphi >= __MULTIGRID_MIN__) ? cavity_workspace_alloc_grid (&coarse_params, 0) : NULL;
+    
+    cav_wspace -> prolong_theta = cav_wspace -> coarse ? (double *) malloc ((size_t) cav_wspace -> Ntheta*cav_wspace -> coarse -> Ntheta*sizeof(double)) : NULL;
+    cav_wspace -> prolong_phi = cav_wspace -> coarse ? (double *) malloc ((size_t) cav_wspace -> Nphi*cav_wspace -> coarse -> Nphi*sizeof(double)) : NULL;
+    
+    /* the options are combined with the precedence above: report those that are not used */
+    if (report){
+        
+        cavity_report_dropped ("cavity_workspace_alloc", "lebedev", params -> lebedev, cav_wspace -> lebedev, "with axisymmetric or spectral");
+        cavity_report_dropped ("cavity_workspace_alloc", "periodic", params -> periodic, cav_wspace -> periodic, "with axisymmetric, spectral or lebedev");
+        cavity_report_dropped ("cavity_workspace_alloc", "anderson", params -> anderson, cav_wspace -> anderson != NULL, "with eigen");
+        cavity_report_dropped ("cavity_workspace_alloc", "block", params -> block > 1, cav_wspace -> block != NULL, "with eigen or anderson");
+        cavity_report_dropped ("cavity_workspace_alloc", "adaptive", params -> adaptive, cav_wspace -> adaptive, "with spectral, lebedev or block");
+        cavity_report_dropped ("cavity_workspace_alloc", "spectral", params -> spectral, cav_wspace -> spectral != NULL, "with eigen or block, which use the axisymmetric grid");
+        cavity_report_dropped ("cavity_workspace_alloc", "the FFT of periodic", cav_wspace -> periodic, cav_wspace -> fft != NULL, "with eigen or block, which use the periodic grid");
+        cavity_report_dropped ("cavity_workspace_alloc", "lean", params -> lean, cav_wspace -> lean != NULL, "with axisymmetric, spectral, lebedev, eigen, block or periodic");
+        cavity_report_dropped ("cavity_workspace_alloc", "single", params -> single, cav_wspace -> single, "with eigen, block, lean, periodic or spectral");
+        cavity_report_dropped ("cavity_workspace_alloc", "multigrid", params -> multigrid && (cav_wspace -> lebedev || cav_wspace -> adaptive || cav_wspace -> block), 0, "with lebedev, adaptive or block");
+    }
     
     return cav_wspace;
 }
 
+/* allocate the memory for the cavity workspace */
+cavity_workspace *cavity_workspace_alloc (const wlc_cavity_params *params){
+    
+    return cavity_workspace_alloc_grid (params, 1);
+}
+
 /* free the memory of the cavity workspace */
 void cavity_workspace_free (cavity_workspace *cav_wspace){
     
@@ -61,6 +192,52 @@ void cavity_workspace_free (cavity_workspace *cav_wspace){
     /* free the scalar product */
     free(cav_wspace -> scalar_prod);
     
+    free(cav_wspace -> sin_theta);
+    free(cav_wspace -> cos_dphi);
+    
+    /* free weights and field factor */
+    free(cav_wspace -> weight);
+    free(cav_wspace -> field);
+    
+    /* free the Boltzmann kernel */
+    free(cav_wspace -> kernel);
+    
+    free(cav_wspace -> kernel_single);
+    free(cav_wspace -> marginal_single);
+    free(cav_wspace -> integral_single);
+    
+    /* free the integrals of the kernel */
+    free(cav_wspace -> integral);
+    
+    /* free the history of the Anderson acceleration */
+    if (cav_wspace -> anderson)
+        cavity_anderson_free (cav_wspace -> anderson);
+    
+    /* and the eigen-solver */
+    if (cav_wspace -> eigen)
+        cavity_eigen_free (cav_wspace -> eigen);
+    
+    /* and the block of marginals */
+    if (cav_wspace -> block)
+        cavity_block_free (cav_wspace -> block);
+    
+    /* and the transforms of the kernel */
+    if (cav_wspace -> fft)
+        cavity_fft_free (cav_wspace -> fft);
+    
+    if (cav_wspace -> lean)
+        cavity_lean_free (cav_wspace -> lean);
+    
+    if (cav_wspace -> spectral)
+        cavity_spectral_free (cav_wspace -> spectral);
+    
+    /* and the coarser grids */
+    if (cav_wspace -> coarse)
+        cavity_workspace_free (cav_wspace -> coarse);
+    
+    free(cav_wspace -> prolong_theta);
+    free(cav_wspace -> prolong_phi);
+    
     /* free the workspace */
     free(cav_wspace);
 }
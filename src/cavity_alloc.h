@@ -22,7 +22,11 @@
 #include "cavity_macros.h"
 #include "cavity.h"
 
-cavity_workspace *cavity_workspace_alloc ();
+void cavity_check_params (const char *, const wlc_cavity_params *, int, int, int);
+
+void cavity_report_dropped (const char *, const char *, int, int, const char *);
+
+cavity_workspace *cavity_workspace_alloc (const wlc_cavity_params *);
 void cavity_workspace_free (cavity_workspace *);
 
 #endif
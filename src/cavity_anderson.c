@@ -0,0 +1,189 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gsl/gsl_cblas.h>
+#include <gsl/gsl_linalg.h>
+#include "cavity_anderson.h"
+
+/******************************************************************
+ *                                                                *
+ *  Anderson acceleration of the fixed-point iteration x = G(x)   *
+ *  of the cavity equations. The new iterate is the combination   *
+ *  of the last maps G(x) whose residuals G(x) - x have the       *
+ *  smallest norm, see e.g. H. F. Walker & P. Ni,                 *
+ *  "Anderson acceleration for fixed-point iterations",           *
+ *  SIAM J. Numer. Anal. 49, (2011), 4: 1715--1735                *
+ *                                                                *
+ *****************************************************************/
+
+/* allocate the history for vectors of nseg segments of n points, with a window of m iterations */
+cavity_anderson *cavity_anderson_alloc (int n, int nseg, int m){
+    
+    cavity_anderson *acc = (cavity_anderson *) malloc (sizeof(cavity_anderson));
+    
+    acc -> n = n;
+    acc -> nseg = nseg;
+    acc -> m = m;
+    
+    acc -> dF = (double *) malloc ((size_t) m*n*nseg*sizeof(double));
+    acc -> dG = (double *) malloc ((size_t) m*n*nseg*sizeof(double));
+    
+    acc -> f = (double *) malloc (n*nseg*sizeof(double));
+    acc -> g = (double *) malloc (n*nseg*sizeof(double));
+    acc -> f_old = (double *) malloc (n*nseg*sizeof(double));
+    acc -> g_old = (double *) malloc (n*nseg*sizeof(double));
+    
+    acc -> M = gsl_matrix_alloc (m, m);
+    acc -> rhs = gsl_vector_alloc (m);
+    acc -> gamma = gsl_vector_alloc (m);
+    
+    cavity_anderson_reset (acc);
+    
+    return acc;
+}
+
+/* free the memory of the Anderson history */
+void cavity_anderson_free (cavity_anderson *acc){
+    
+    free (acc -> dF);
+    free (acc -> dG);
+    
+    free (acc -> f);
+    free (acc -> g);
+    free (acc -> f_old);
+    free (acc -> g_old);
+    
+    gsl_matrix_free (acc -> M);
+    gsl_vector_free (acc -> rhs);
+    gsl_vector_free (acc -> gamma);
+    
+    free (acc);
+}
+
+/* forget the history, e.g. when the map G changes */
+void cavity_anderson_reset (cavity_anderson *acc){
+    
+    acc -> k = -1;
+    acc -> pos = 0;
+}
+
+/* given the current iterate x and the map g = G(x), replace g with the Anderson mixing of the last iterations */
+/* the first segment is the marginal: if the mixing makes it non-positive, the plain iterate g is kept */
+/* and the history is restarted. The mixing is an affine combination of normalised marginals, */
+/* so that it is normalised as well */
+void cavity_anderson_mix (cavity_anderson *acc, double * const *x, double * const *g){
+    
+    int i, j, s, l, N = acc -> n * acc -> nseg, k;
+    double *dF, *dG, *tmp, ridge = 0.;
+    
+    /* gather the residual f = g - x and the map g in contiguous vectors */
+    for (s=0; s<acc -> nseg; s++)
+        for (i=0; i<acc -> n; i++){
+            
+            *(acc -> g + s*acc -> n + i) = *(g[s] + i);
+            *(acc -> f + s*acc -> n + i) = *(g[s] + i) - *(x[s] + i);
+        }
+    
+    /* store the differences with the previous iteration in the history */
+    if (acc -> k >= 0){
+        
+        dF = acc -> dF + (size_t) acc -> pos*N;
+        dG = acc -> dG + (size_t) acc -> pos*N;
+        
+        for (i=0; i<N; i++){
+            
+            *(dF + i) = *(acc -> f + i) - *(acc -> f_old + i);
+            *(dG + i) = *(acc -> g + i) - *(acc -> g_old + i);
+        }
+        
+        acc -> pos = (acc -> pos+1) % acc -> m;
+        
+        if (acc -> k < acc -> m)
+            acc -> k++;
+    }
+    else
+        acc -> k = 0;
+    
+    /* keep the current residual and map for the next iteration */
+    tmp = acc -> f_old;
+    acc -> f_old = acc -> f;
+    acc -> f = tmp;
+    
+    tmp = acc -> g_old;
+    acc -> g_old = acc -> g;
+    acc -> g = tmp;
+    
+    k = acc -> k;
+    
+    /* no history yet: keep the plain iterate */
+    if (k == 0)
+        return;
+    
+    /* normal equations of min |f - dF gamma|, with a small ridge to cope with nearly dependent differences */
+    for (i=0; i<k; i++){
+        
+        for (j=0; j<=i; j++){
+            
+            gsl_matrix_set (acc -> M, i, j, cblas_ddot (N, acc -> dF + (size_t) i*N, 1, acc -> dF + (size_t) j*N, 1));
+            gsl_matrix_set (acc -> M, j, i, gsl_matrix_get (acc -> M, i, j));
+        }
+        
+        gsl_vector_set (acc -> rhs, i, cblas_ddot (N, acc -> dF + (size_t) i*N, 1, acc -> f_old, 1));
+        
+        ridge += gsl_matrix_get (acc -> M, i, i);
+    }
+    
+    /* all the differences vanish: nothing to mix */
+    if (!(ridge > 0.)){
+        
+        cavity_anderson_reset (acc);
+        return;
+    }
+    
+    ridge *= 1.e-12;
+    
+    for (i=0; i<k; i++)
+        gsl_matrix_set (acc -> M, i, i, gsl_matrix_get (acc -> M, i, i) + ridge);
+    
+    {
+        gsl_matrix_view M = gsl_matrix_submatrix (acc -> M, 0, 0, k, k);
+        gsl_vector_view rhs = gsl_vector_subvector (acc -> rhs, 0, k);
+        gsl_vector_view gamma = gsl_vector_subvector (acc -> gamma, 0, k);
+        
+        gsl_linalg_cholesky_decomp (&M.matrix);
+        gsl_linalg_cholesky_solve (&M.matrix, &rhs.vector, &gamma.vector);
+    }
+    
+    /* the mixed iterate is g - dG gamma; reuse the free buffer f to build it */
+    cblas_dcopy (N, acc -> g_old, 1, acc -> f, 1);
+    
+    for (l=0; l<k; l++)
+        cblas_daxpy (N, -gsl_vector_get (acc -> gamma, l), acc -> dG + (size_t) l*N, 1, acc -> f, 1);
+    
+    /* the marginal must stay positive, otherwise restart the history from the plain iterate */
+    for (i=0; i<acc -> n; i++)
+        if (!(*(acc -> f + i) > 0.)){
+            
+            cavity_anderson_reset (acc);
+            return;
+        }
+    
+    /* copy back the mixed iterate */
+    for (s=0; s<acc -> nseg; s++)
+        for (i=0; i<acc -> n; i++)
+            *(g[s] + i) = *(acc -> f + s*acc -> n + i);
+}
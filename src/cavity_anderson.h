@@ -0,0 +1,63 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CAVITY_ANDERSON_H__
+#define __CAVITY_ANDERSON_H__
+
+#include <stdlib.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_vector.h>
+
+/* history of the iteration used by the Anderson acceleration of the cavity equations */
+/* the iterated vector is made of nseg segments of n points each: the marginal, */
+/* followed by its derivatives when the gradient is iterated as well */
+typedef struct{
+    
+    int n;
+    int nseg;
+    
+    /* size of the history window, number of stored differences and position of the next one */
+    int m;
+    int k;
+    int pos;
+    
+    /* differences of the residuals f = G(x) - x and of the maps G(x) between consecutive iterations */
+    double *dF;
+    double *dG;
+    
+    /* residual and map at the current and at the previous iteration */
+    double *f;
+    double *g;
+    double *f_old;
+    double *g_old;
+    
+    /* normal equations of the least-squares problem */
+    gsl_matrix *M;
+    gsl_vector *rhs;
+    gsl_vector *gamma;
+    
+} cavity_anderson;
+
+cavity_anderson *cavity_anderson_alloc (int, int, int);
+
+void cavity_anderson_free (cavity_anderson *);
+
+void cavity_anderson_reset (cavity_anderson *);
+
+void cavity_anderson_mix (cavity_anderson *, double * const *, double * const *);
+
+#endif
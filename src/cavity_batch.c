@@ -0,0 +1,203 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include "cavity_solver.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#endif
+
+/* evaluations of the cavity functions on batches of independent points (f[k], bB[k], JB[k]) */
+/* the points are handed out one at a time to a team of threads, as the number of iterations varies */
+/* a lot from point to point: by OpenMP when compiled with it, by a pool of POSIX threads otherwise. */
+/* Each thread keeps its own solver, and thus reuses the kernel while consecutive points share the */
+/* same JB. Every point starts from the uniform marginal, so that the results do not depend on the scheduling */
+
+#ifndef _OPENMP
+
+/* a batch shared by the threads of the pool, which take its points in turn from the counter next; */
+/* drho_dbB is NULL when only rho is computed */
+typedef struct {
+    
+    const double *f;
+    const double *bB;
+    const double *JB;
+    size_t n;
+    
+    double *rho;
+    double *drho_dbB;
+    double *drho_dJB;
+    double *xi_f;
+    
+    const wlc_cavity_params *params;
+    
+    atomic_size_t next;
+    
+} cavity_batch;
+
+/* evaluate the points of the batch until there are none left */
+static void *cavity_batch_worker (void *arg){
+    
+    cavity_batch *batch = (cavity_batch *) arg;
+    wlc_cavity_solver *solver = wlc_cavity_solver_alloc (batch -> params);
+    size_t k;
+    
+    while ((k = atomic_fetch_add (&batch -> next, 1)) < batch -> n){
+        
+        if (batch -> drho_dbB)
+            batch -> rho[k] = wlc_cavity_solver_rho_F_and_gradient (solver, batch -> f[k], batch -> bB[k], batch -> JB[k], batch -> drho_dbB+k, batch -> drho_dJB+k, batch -> xi_f+k);
+        else
+            batch -> rho[k] = wlc_cavity_solver_rho_F (solver, batch -> f[k], batch -> bB[k], batch -> JB[k]);
+    }
+    
+    wlc_cavity_solver_free (solver);
+    
+    return NULL;
+}
+
+/* evaluate the batch with nthreads threads, the calling one included; nthreads <= 0 uses one per online */
+/* processor. A thread that cannot be created only leaves its share to the others */
+static void cavity_batch_run (cavity_batch *batch, int nthreads){
+    
+    pthread_t *threads;
+    int t, started;
+    
+    if (nthreads <= 0)
+        nthreads = (int) sysconf (_SC_NPROCESSORS_ONLN);
+    
+    if (nthreads < 1)
+        nthreads = 1;
+    
+    if ((size_t) nthreads > batch -> n)
+        nthreads = (int) batch -> n;
+    
+    if (nthreads == 0)
+        return;
+    
+    atomic_init (&batch -> next, 0);
+    
+    threads = (pthread_t *) malloc (nthreads*sizeof(pthread_t));
+    
+    for (t=1, started=1; t<nthreads; t++)
+        if (pthread_create (threads+started, NULL, cavity_batch_worker, batch) == 0)
+            started++;
+    
+    cavity_batch_worker (batch);
+    
+    for (t=1; t<started; t++)
+        pthread_join (threads[t], NULL);
+    
+    free (threads);
+}
+
+#endif
+
+/* compute cavity elongation rho for the n points (f[k], bB[k], JB[k]), storing it in rho[k] */
+/* params may be NULL for the default parameters, nthreads <= 0 uses all available threads */
+void wlc_rho_F_cavity_batch (const double *f, const double *bB, const double *JB, size_t n, double *rho, const wlc_cavity_params *params, int nthreads){
+    
+    wlc_cavity_params default_params;
+    
+    if (params == NULL){
+        
+        wlc_cavity_params_default (&default_params);
+        params = &default_params;
+    }
+    
+#ifdef _OPENMP
+    if (nthreads <= 0)
+        nthreads = omp_get_max_threads();
+    
+#pragma omp parallel num_threads(nthreads)
+    {
+        long k;
+        wlc_cavity_solver *solver = wlc_cavity_solver_alloc (params);
+        
+#pragma omp for schedule(dynamic, 1)
+        for (k=0; k<(long) n; k++)
+            rho[k] = wlc_cavity_solver_rho_F (solver, f[k], bB[k], JB[k]);
+        
+        wlc_cavity_solver_free (solver);
+    }
+#else
+    {
+        cavity_batch batch;
+        
+        batch.f = f;
+        batch.bB = bB;
+        batch.JB = JB;
+        batch.n = n;
+        batch.rho = rho;
+        batch.drho_dbB = NULL;
+        batch.drho_dJB = NULL;
+        batch.xi_f = NULL;
+        batch.params = params;
+        
+        cavity_batch_run (&batch, nthreads);
+    }
+#endif
+}
+
+/* compute cavity elongation rho, its gradient and the correlation length for the n points (f[k], bB[k], JB[k]) */
+/* params may be NULL for the default parameters, nthreads <= 0 uses all available threads */
+void wlc_rho_F_cavity_and_gradient_batch (const double *f, const double *bB, const double *JB, size_t n, double *rho, double *drho_dbB, double *drho_dJB, double *xi_f, const wlc_cavity_params *params, int nthreads){
+    
+    wlc_cavity_params default_params;
+    
+    if (params == NULL){
+        
+        wlc_cavity_params_default (&default_params);
+        params = &default_params;
+    }
+    
+#ifdef _OPENMP
+    if (nthreads <= 0)
+        nthreads = omp_get_max_threads();
+    
+#pragma omp parallel num_threads(nthreads)
+    {
+        long k;
+        wlc_cavity_solver *solver = wlc_cavity_solver_alloc (params);
+        
+#pragma omp for schedule(dynamic, 1)
+        for (k=0; k<(long) n; k++)
+            rho[k] = wlc_cavity_solver_rho_F_and_gradient (solver, f[k], bB[k], JB[k], drho_dbB+k, drho_dJB+k, xi_f+k);
+        
+        wlc_cavity_solver_free (solver);
+    }
+#else
+    {
+        cavity_batch batch;
+        
+        batch.f = f;
+        batch.bB = bB;
+        batch.JB = JB;
+        batch.n = n;
+        batch.rho = rho;
+        batch.drho_dbB = drho_dbB;
+        batch.drho_dJB = drho_dJB;
+        batch.xi_f = xi_f;
+        batch.params = params;
+        
+        cavity_batch_run (&batch, nthreads);
+    }
+#endif
+}
@@ -0,0 +1,217 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <gsl/gsl_cblas.h>
+#include <gsl/gsl_errno.h>
+#include "cavity_macros.h"
+#include "cavity.h"
+#include "cavity_kernel.h"
+
+/* allocate the marginals of a block of up to m forces on a grid of n points */
+cavity_block *cavity_block_alloc (int n, int m){
+    
+    cavity_block *blk = (cavity_block *) malloc (sizeof(cavity_block));
+    
+    blk -> n = n;
+    blk -> m = m;
+    
+    blk -> marginal = (double *) malloc ((size_t) n*m*sizeof(double));
+    blk -> marginal_dummy = (double *) malloc ((size_t) n*m*sizeof(double));
+    blk -> field = (double *) malloc ((size_t) n*m*sizeof(double));
+    blk -> result = (double *) malloc ((size_t) n*m*sizeof(double));
+    
+    blk -> index = (int *) malloc (m*sizeof(int));
+    blk -> iter = (unsigned int *) malloc (m*sizeof(unsigned int));
+    blk -> converged = (int *) malloc (m*sizeof(int));
+    
+    blk -> history = (double *) malloc (4*m*sizeof(double));
+    
+    return blk;
+}
+
+/* free the memory of the block */
+void cavity_block_free (cavity_block *blk){
+    
+    free (blk -> marginal);
+    free (blk -> marginal_dummy);
+    free (blk -> field);
+    free (blk -> result);
+    
+    free (blk -> index);
+    free (blk -> iter);
+    free (blk -> converged);
+    
+    free (blk -> history);
+    
+    free (blk);
+}
+
+/* move the column src of the marginals being iterated to the column dst */
+static void cavity_block_move (cavity_block *blk, int src, int dst){
+    
+    cblas_dcopy (blk -> n, blk -> marginal + (size_t) src*blk -> n, 1, blk -> marginal + (size_t) dst*blk -> n, 1);
+    cblas_dcopy (blk -> n, blk -> marginal_dummy + (size_t) src*blk -> n, 1, blk -> marginal_dummy + (size_t) dst*blk -> n, 1);
+    cblas_dcopy (blk -> n, blk -> field + (size_t) src*blk -> n, 1, blk -> field + (size_t) dst*blk -> n, 1);
+    
+    *(blk -> index + dst) = *(blk -> index + src);
+}
+
+/* iterate Eq. (9) of Massucci et al. 2014 for the m <= block size forces f[k] at the same bB, JB */
+/* each sweep is a single matrix-matrix product of the kernel with the marginals of the forces that have */
+/* not converged yet; converged forces are moved to the result and the others are packed in their place. */
+/* All the forces start from the marginal of the workspace, which is left to the marginal of the last force */
+int cavity_iterate_marginal_block (cavity_workspace *cav_w, const double *f, int m, double bB, double JB){
+    
+    cavity_block *blk = cav_w -> block;
+    int i, k, n = cav_w -> npoints, active = m;
+    unsigned int iter=0;
+    double error, *P, *p1, *p2, *field, Z, shift, integral, dZ, rho, Z_rho;
+    
+    /* the change of the marginal is tested unless only the observables are */
+    int weighted = cav_w -> criterion & WLC_CAVITY_WEIGHTED;
+    int observables = cav_w -> criterion & WLC_CAVITY_OBSERVABLES;
+    int marginal = weighted || !observables;
+    
+    cavity_update_kernel (cav_w, JB);
+    
+    for (k=0; k<m; k++){
+        
+        cblas_dcopy (n, cav_w -> marginal, 1, blk -> marginal + (size_t) k*n, 1);
+        
+        shift = cavity_compute_field (blk -> field + (size_t) k*n, cav_w -> cos_theta, f[k], bB, cav_w -> Ntheta, cav_w -> Nphi);
+        
+        /* the leading eigenvalue is kept for the last force */
+        if (k == m-1)
+            cav_w -> log_scale = fabs(JB) + shift;
+        
+        *(blk -> index + k) = k;
+        *(blk -> converged + k) = 0;
+        
+        for (i=0; i<4; i++)
+            *(blk -> history + 4*k + i) = HUGE_VAL;
+    }
+    
+    while (active > 0 && iter < cav_w -> max_iter){
+        
+        iter++;
+        
+        /* the integrals of all the active marginals: the kernel is stored row-major, i.e. transposed for */
+        /* the column-major block of marginals */
+        cblas_dgemm (CblasColMajor, CblasTrans, CblasNoTrans, n, active, n, 1., cav_w -> kernel, n, blk -> marginal, n, 0., blk -> marginal_dummy, n);
+        
+        k = 0;
+        
+        while (k < active){
+            
+            p1 = blk -> marginal + (size_t) k*n;
+            p2 = blk -> marginal_dummy + (size_t) k*n;
+            field = blk -> field + (size_t) k*n;
+            
+            /* P = exp (b_B * f * z*t) * Integral(t), and its normalisation */
+            Z = 0.;
+            rho = 0.;
+            Z_rho = 0.;
+            i = 0;
+            
+            for (P = p2; P < p2+n; P++){
+                
+                integral = *P;
+                
+                *P *= *(field + i);
+                
+                Z += *P * *(cav_w -> weight + i);
+                
+                if (observables){
+                    
+                    dZ = *P * integral * *(cav_w -> weight + i);
+                    
+                    rho += *(cav_w -> cos_theta+ i/cav_w -> Nphi) * dZ;
+                    Z_rho += dZ;
+                }
+                
+                i++;
+            }
+            
+            error = 0.;
+            i = 0;
+            
+            for (P = p2; P < p2+n; P++){
+                
+                *P /= Z;
+                
+                if (weighted)
+                    error += fabs(*P-*(p1+i)) * *(cav_w -> weight + i);
+                else if (marginal)
+                    error += fabs(*P-*(p1+i));
+                
+                i++;
+            }
+            
+            /* the error of rho and of the normalisation */
+            if (observables)
+                error = fmax (error, cavity_observables_error (rho/Z_rho, Z, blk -> history + 4 * *(blk -> index + k)));
+            
+            /* the normalisation of the last force gives the leading eigenvalue at the end of the curve */
+            if (*(blk -> index + k) == m-1)
+                cav_w -> lambda = Z;
+            
+            /* converged: store the marginal and pack the last active column in its place */
+            if (error <= cav_w -> tol){
+                
+                cblas_dcopy (n, p2, 1, blk -> result + (size_t) *(blk -> index + k)*n, 1);
+                
+                *(blk -> iter + *(blk -> index + k)) = iter;
+                *(blk -> converged + *(blk -> index + k)) = 1;
+                
+                active--;
+                
+                if (k < active)
+                    cavity_block_move (blk, active, k);
+                
+                continue;
+            }
+            
+            k++;
+        }
+        
+        /* swap the blocks for further iteration */
+        P = blk -> marginal_dummy;
+        
+        blk -> marginal_dummy = blk -> marginal;
+        
+        blk -> marginal = P;
+    }
+    
+    /* keep the last iterate of the forces that did not converge */
+    for (k=0; k<active; k++){
+        
+        cblas_dcopy (n, blk -> marginal + (size_t) k*n, 1, blk -> result + (size_t) *(blk -> index + k)*n, 1);
+        
+        *(blk -> iter + *(blk -> index + k)) = iter;
+    }
+    
+    /* the last force is the starting point of a following call */
+    cblas_dcopy (n, blk -> result + (size_t) (m-1)*n, 1, cav_w -> marginal, 1);
+    
+    cav_w -> iter = 0;
+    
+    for (k=0; k<m; k++)
+        cav_w -> iter += *(blk -> iter + k);
+    
+    /* signal if some of the forces stopped before reaching convergence */
+    return active > 0 ? GSL_CONTINUE : GSL_SUCCESS;
+}
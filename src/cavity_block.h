@@ -0,0 +1,53 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __CAVITY_BLOCK_H__
+#define __CAVITY_BLOCK_H__
+
+#include <stdlib.h>
+
+/* marginals of a block of forces, iterated together at the same bB, JB: the integrals of Eq. (9) */
+/* of Massucci et al. (2014) for all the forces are then a single matrix-matrix product with the kernel */
+typedef struct{
+    
+    /* number of points of the grid and maximum number of forces in a block */
+    int n;
+    int m;
+    
+    /* marginals and field factors of the forces still being iterated, one contiguous column of n points per force */
+    double *marginal;
+    double *marginal_dummy;
+    double *field;
+    
+    /* force of each column being iterated */
+    int *index;
+    
+    /* converged marginals, in the order of the forces, with their number of iterations */
+    double *result;
+    unsigned int *iter;
+    int *converged;
+    
+    /* elongation and normalisation of each force at the previous sweep and their changes, */
+    /* four values per force, for the test on the observables (see cavity_observables_error) */
+    double *history;
+    
+} cavity_block;
+
+cavity_block *cavity_block_alloc (int, int);
+
+void cavity_block_free (cavity_block *);
+
+#endif
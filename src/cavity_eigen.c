@@ -0,0 +1,277 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <gsl/gsl_cblas.h>
+#include <gsl/gsl_errno.h>
+#include "cavity_macros.h"
+#include "cavity_eigen.h"
+#include "cavity_kernel.h"
+
+/******************************************************************
+ *                                                                *
+ *  Eigen-solver of the cavity equations. The cavity marginal is  *
+ *  the Perron eigenvector of the transfer operator               *
+ *  diag(field) * kernel, and the leading eigenvalue is the       *
+ *  normalisation of the marginal at the fixed point.             *
+ *  Since the kernel is w_j * exp(J * t_i*u_j), the operator is   *
+ *  similar to the symmetric diag(a) * kernel * diag(b), with     *
+ *  a = sqrt(field*weight), b = sqrt(field/weight).               *
+ *                                                                *
+ *****************************************************************/
+
+/* allocate the eigen-solver for a grid of n points */
+cavity_eigen *cavity_eigen_alloc (int n){
+    
+    cavity_eigen *eig = (cavity_eigen *) malloc (sizeof(cavity_eigen));
+    
+    eig -> n = n;
+    
+    eig -> a = (double *) malloc (n*sizeof(double));
+    eig -> b = (double *) malloc (n*sizeof(double));
+    
+    eig -> kmax = n < __EIGEN_KRYLOV__ ? n : __EIGEN_KRYLOV__;
+    
+    eig -> V = NULL;
+    eig -> alpha = NULL;
+    eig -> beta = NULL;
+    eig -> T = NULL;
+    eig -> Y = NULL;
+    eig -> theta = NULL;
+    eig -> T_w = NULL;
+    
+    eig -> B = NULL;
+    eig -> evec = NULL;
+    eig -> eval = NULL;
+    eig -> B_w = NULL;
+    
+    /* small grids: dense diagonalisation of the symmetrised operator */
+    if (n <= __EIGEN_DENSE__){
+        
+        eig -> B = gsl_matrix_alloc (n, n);
+        eig -> evec = gsl_matrix_alloc (n, n);
+        eig -> eval = gsl_vector_alloc (n);
+        eig -> B_w = gsl_eigen_symmv_alloc (n);
+    }
+    /* large grids: Lanczos iteration, which only needs products with the kernel */
+    else {
+        
+        eig -> V = (double *) malloc ((size_t) (eig -> kmax+1)*n*sizeof(double));
+        eig -> alpha = (double *) malloc (eig -> kmax*sizeof(double));
+        eig -> beta = (double *) malloc (eig -> kmax*sizeof(double));
+        
+        eig -> T = gsl_matrix_alloc (eig -> kmax, eig -> kmax);
+        eig -> Y = gsl_matrix_alloc (eig -> kmax, eig -> kmax);
+        eig -> theta = gsl_vector_alloc (eig -> kmax);
+        eig -> T_w = gsl_eigen_symmv_alloc (eig -> kmax);
+    }
+    
+    return eig;
+}
+
+/* free the memory of the eigen-solver */
+void cavity_eigen_free (cavity_eigen *eig){
+    
+    free (eig -> a);
+    free (eig -> b);
+    
+    if (eig -> B){
+        
+        gsl_matrix_free (eig -> B);
+        gsl_matrix_free (eig -> evec);
+        gsl_vector_free (eig -> eval);
+        gsl_eigen_symmv_free (eig -> B_w);
+    }
+    else {
+        
+        free (eig -> V);
+        free (eig -> alpha);
+        free (eig -> beta);
+        
+        gsl_matrix_free (eig -> T);
+        gsl_matrix_free (eig -> Y);
+        gsl_vector_free (eig -> theta);
+        gsl_eigen_symmv_free (eig -> T_w);
+    }
+    
+    free (eig);
+}
+
+/* y = diag(a) * kernel * diag(b) * x; x is overwritten */
+static void cavity_eigen_apply (cavity_eigen *eig, const double *kernel, double *x, double *y){
+    
+    int i;
+    
+    for (i=0; i<eig -> n; i++)
+        *(x+i) *= *(eig -> b+i);
+    
+    cavity_kernel_product (kernel, x, 0., y, eig -> n);
+    
+    for (i=0; i<eig -> n; i++)
+        *(y+i) *= *(eig -> a+i);
+}
+
+/* leading eigenpair of the tridiagonal Lanczos matrix of size k: eigenvalue in theta[0], eigenvector in the first column of Y */
+static void cavity_eigen_tridiagonal (cavity_eigen *eig, int k){
+    
+    int i, j;
+    gsl_matrix_view T = gsl_matrix_submatrix (eig -> T, 0, 0, k, k);
+    gsl_matrix_view Y = gsl_matrix_submatrix (eig -> Y, 0, 0, k, k);
+    gsl_vector_view theta = gsl_vector_subvector (eig -> theta, 0, k);
+    
+    for (i=0; i<k; i++)
+        for (j=0; j<k; j++)
+            gsl_matrix_set (&T.matrix, i, j, i==j ? *(eig -> alpha+i) : (i==j+1 ? *(eig -> beta+j) : (j==i+1 ? *(eig -> beta+i) : 0.)));
+    
+    gsl_eigen_symmv (&T.matrix, &theta.vector, &Y.matrix, eig -> T_w);
+    gsl_eigen_symmv_sort (&theta.vector, &Y.matrix, GSL_EIGEN_SORT_VAL_DESC);
+}
+
+/* leading eigenvector u of the symmetrised operator, by a Lanczos iteration with full reorthogonalisation */
+/* and explicit restarts from the current Ritz vector. u holds the starting vector on entry. */
+/* Stop when |B u - lambda u| <= tol * (lambda - lambda_2), or after max_iter products with the kernel */
+static int cavity_eigen_lanczos (cavity_eigen *eig, const double *kernel, double tol, unsigned int max_iter, double *u, double *lambda, unsigned int *iter){
+    
+    int i, j, k=0, n = eig -> n, converged = 0;
+    double *v, *w, norm, residual, gap;
+    
+    *iter = 0;
+    
+    do {
+        
+        /* the first vector of the basis is the normalised starting vector */
+        norm = cblas_dnrm2 (n, u, 1);
+        
+        for (i=0; i<n; i++)
+            *(eig -> V+i) = *(u+i)/norm;
+        
+        for (j=0; j<eig -> kmax; j++){
+            
+            v = eig -> V + (size_t) j*n;
+            w = eig -> V + (size_t) (j+1)*n;
+            
+            /* w = B v; v is scaled by the product, so keep a copy in u */
+            cblas_dcopy (n, v, 1, u, 1);
+            cavity_eigen_apply (eig, kernel, u, w);
+            
+            (*iter)++;
+            
+            *(eig -> alpha+j) = cblas_ddot (n, v, 1, w, 1);
+            
+            /* orthogonalise against the whole basis, which also removes the three-term recurrence */
+            for (i=0; i<=j; i++)
+                cblas_daxpy (n, -cblas_ddot (n, eig -> V + (size_t) i*n, 1, w, 1), eig -> V + (size_t) i*n, 1, w, 1);
+            
+            *(eig -> beta+j) = cblas_dnrm2 (n, w, 1);
+            
+            k = j+1;
+            
+            /* the residual of the leading Ritz pair is beta_j times the last component of its eigenvector */
+            cavity_eigen_tridiagonal (eig, k);
+            
+            *lambda = gsl_vector_get (eig -> theta, 0);
+            residual = fabs (*(eig -> beta+j) * gsl_matrix_get (eig -> Y, k-1, 0));
+            
+            /* the error on the eigenvector is bounded by the residual over the gap to the next eigenvalue, */
+            /* which is estimated by the second Ritz value */
+            gap = k > 1 ? *lambda - gsl_vector_get (eig -> theta, 1) : 0.;
+            
+            if (residual <= tol * gap || k == n){
+                
+                converged = 1;
+                break;
+            }
+            
+            if (*iter >= max_iter)
+                break;
+            
+            cblas_dscal (n, 1./ *(eig -> beta+j), w, 1);
+        }
+        
+        /* Ritz vector, used as the result or as the restart vector */
+        for (i=0; i<n; i++)
+            *(u+i) = 0.;
+        
+        for (j=0; j<k; j++)
+            cblas_daxpy (n, gsl_matrix_get (eig -> Y, j, 0), eig -> V + (size_t) j*n, 1, u, 1);
+    }
+    while (!converged && *iter < max_iter);
+    
+    return converged ? GSL_SUCCESS : GSL_CONTINUE;
+}
+
+/* leading eigenvector of diag(field) * kernel, normalised to sum_i weight_i * marginal_i = 1, and its eigenvalue */
+/* marginal holds the starting vector of the Lanczos iteration on entry. iter counts the products with the kernel, */
+/* a dense diagonalisation counts as one */
+int cavity_eigen_marginal (cavity_eigen *eig, const double *kernel, const double *field, const double *weight, double tol, unsigned int max_iter, double *marginal, double *lambda, unsigned int *iter){
+    
+    int i, j, n = eig -> n, status = GSL_SUCCESS;
+    double Z=0.;
+    
+    for (i=0; i<n; i++){
+        
+        *(eig -> a+i) = sqrt (*(field+i) * *(weight+i));
+        *(eig -> b+i) = sqrt (*(field+i) / *(weight+i));
+    }
+    
+    if (eig -> B){
+        
+        /* B_ij = a_i * kernel_ij * b_j */
+        for (i=0; i<n; i++)
+            for (j=0; j<n; j++)
+                gsl_matrix_set (eig -> B, i, j, *(eig -> a+i) * *(kernel + (size_t) i*n + j) * *(eig -> b+j));
+        
+        gsl_eigen_symmv (eig -> B, eig -> eval, eig -> evec, eig -> B_w);
+        gsl_eigen_symmv_sort (eig -> eval, eig -> evec, GSL_EIGEN_SORT_VAL_DESC);
+        
+        *lambda = gsl_vector_get (eig -> eval, 0);
+        
+        for (i=0; i<n; i++)
+            *(marginal+i) = gsl_matrix_get (eig -> evec, i, 0);
+        
+        *iter = 1;
+    }
+    else {
+        
+        /* the eigenvector u of the symmetrised operator is related to the marginal by marginal = b * u; */
+        /* where the scaled field underflows to 0, so do b and the row of the operator, and u is exactly 0 */
+        for (i=0; i<n; i++)
+            *(marginal+i) = *(eig -> b+i) > 0. ? *(marginal+i) / *(eig -> b+i) : 0.;
+        
+        status = cavity_eigen_lanczos (eig, kernel, tol, max_iter, marginal, lambda, iter);
+    }
+    
+    /* a non-finite eigenvector cannot be normalised */
+    for (i=0; i<n; i++)
+        if (!isfinite (*(marginal+i)))
+            return GSL_EFAILED;
+    
+    /* back to the marginal, with the sign fixed by the normalisation */
+    for (i=0; i<n; i++){
+        
+        *(marginal+i) *= *(eig -> b+i);
+        
+        Z += *(marginal+i) * *(weight+i);
+    }
+    
+    if (!isfinite (Z) || Z == 0.)
+        return GSL_EFAILED;
+    
+    for (i=0; i<n; i++)
+        *(marginal+i) /= Z;
+    
+    return status;
+}
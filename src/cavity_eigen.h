@@ -0,0 +1,65 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __CAVITY_EIGEN_H__
+#define __CAVITY_EIGEN_H__
+
+#include <stdlib.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_eigen.h>
+
+/* workspace of the eigen-solver of the cavity equations */
+/* the fixed point of Eq. (9) of Massucci et al. (2014) is the leading eigenvector of diag(field) * kernel, */
+/* which is similar to the symmetric operator diag(a) * kernel * diag(b), with a = sqrt(field*weight) */
+/* and b = sqrt(field/weight). Small grids are diagonalised densely, larger ones with a Lanczos iteration */
+typedef struct{
+    
+    int n;
+    
+    /* scaling factors of the symmetrised operator */
+    double *a;
+    double *b;
+    
+    /* dimension of the Krylov space before the Lanczos iteration is restarted */
+    int kmax;
+    
+    /* Lanczos basis of kmax+1 vectors of n points, diagonal and off-diagonal of the tridiagonal matrix */
+    double *V;
+    double *alpha;
+    double *beta;
+    
+    /* eigen-decomposition of the tridiagonal matrix */
+    gsl_matrix *T;
+    gsl_matrix *Y;
+    gsl_vector *theta;
+    gsl_eigen_symmv_workspace *T_w;
+    
+    /* symmetrised operator and its eigen-decomposition, for small grids */
+    gsl_matrix *B;
+    gsl_matrix *evec;
+    gsl_vector *eval;
+    gsl_eigen_symmv_workspace *B_w;
+    
+} cavity_eigen;
+
+cavity_eigen *cavity_eigen_alloc (int);
+
+void cavity_eigen_free (cavity_eigen *);
+
+int cavity_eigen_marginal (cavity_eigen *, const double *, const double *, const double *, double, unsigned int, double *, double *, unsigned int *);
+
+#endif
@@ -0,0 +1,121 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cavity_macros.h"
+#include "cavity_fft.h"
+
+/******************************************************************
+ *                                                                *
+ *  Products with the Boltzmann kernel on a grid uniform and      *
+ *  periodic in phi, phi_k = 2 pi k/Nphi with weights 2 pi/Nphi,  *
+ *  as circular convolutions in phi: O(Ntheta^2 Nphi) products    *
+ *  and O(Ntheta Nphi log Nphi) transforms instead of the         *
+ *  O(Ntheta^2 Nphi^2) dense product.                             *
+ *                                                                *
+ *****************************************************************/
+
+/* allocate the transforms of the kernel and of the marginal, and the FFT tables */
+cavity_fft *cavity_fft_alloc (int Ntheta, int Nphi){
+    
+    cavity_fft *fft = (cavity_fft *) malloc (sizeof(cavity_fft));
+    
+    fft -> Ntheta = Ntheta;
+    fft -> Nphi = Nphi;
+    
+    fft -> kernel = (double *) malloc ((size_t) Ntheta*Ntheta*Nphi*sizeof(double));
+    fft -> transform = (double *) malloc ((size_t) Ntheta*Nphi*sizeof(double));
+    
+    fft -> real = gsl_fft_real_wavetable_alloc (Nphi);
+    fft -> halfcomplex = gsl_fft_halfcomplex_wavetable_alloc (Nphi);
+    fft -> work = gsl_fft_real_workspace_alloc (Nphi);
+    
+    return fft;
+}
+
+/* free the transforms and the FFT tables */
+void cavity_fft_free (cavity_fft *fft){
+    
+    free (fft -> kernel);
+    free (fft -> transform);
+    
+    gsl_fft_real_wavetable_free (fft -> real);
+    gsl_fft_halfcomplex_wavetable_free (fft -> halfcomplex);
+    gsl_fft_real_workspace_free (fft -> work);
+    
+    free (fft);
+}
+
+/* compute the transforms of the blocks of the kernel w(theta') 2 pi/Nphi * exp(J * t*u - |J|), */
+/* with t*u = cos(theta)cos(theta') + sin(theta)sin(theta') cos(2 pi m/Nphi) for phi - phi' = 2 pi m/Nphi */
+void cavity_fft_compute_kernel (cavity_fft *fft, const double *cos_theta, const double *w_cos_theta, double JB){
+    
+    int a, b, m, Ntheta = fft -> Ntheta, Nphi = fft -> Nphi;
+    double cc, ss, w, *K;
+    
+    for (a=0; a<Ntheta; a++)
+        for (b=0; b<Ntheta; b++){
+            
+            K = fft -> kernel + ((size_t) a*Ntheta + b)*Nphi;
+            
+            cc = *(cos_theta + a) * *(cos_theta + b);
+            ss = sqrt(1.-*(cos_theta + a) * *(cos_theta + a))*sqrt(1.-*(cos_theta + b) * *(cos_theta + b));
+            w = *(w_cos_theta + b) * 2*M_PI/Nphi;
+            
+            for (m=0; m<Nphi; m++)
+                *(K + m) = w*exp(JB*(cc + ss*cos(2*M_PI*m/Nphi)) - fabs(JB));
+            
+            gsl_fft_real_transform (K, 1, Nphi, fft -> real, fft -> work);
+            
+            /* the imaginary parts vanish: replace them by the real parts of the same frequency */
+            for (m=2; m<Nphi; m+=2)
+                *(K + m) = *(K + m-1);
+        }
+}
+
+/* compute out = K * p: transform the rows of p, multiply them by the transforms of the kernel */
+/* and sum over theta' in Fourier space, then transform back the rows of out. */
+/* The sums for each theta are shared among the OpenMP threads on large grids */
+void cavity_fft_product (cavity_fft *fft, const double *p, double *out){
+    
+    int a, b, k, Ntheta = fft -> Ntheta, Nphi = fft -> Nphi;
+    
+    memcpy (fft -> transform, p, (size_t) Ntheta*Nphi*sizeof(double));
+    
+    for (b=0; b<Ntheta; b++)
+        gsl_fft_real_transform (fft -> transform + b*Nphi, 1, Nphi, fft -> real, fft -> work);
+    
+#ifdef _OPENMP
+#pragma omp parallel for private(b, k) schedule(static) if (Ntheta*Nphi >= __OMP_MIN_POINTS__)
+#endif
+    for (a=0; a<Ntheta; a++){
+        
+        double *O = out + a*Nphi;
+        const double *K = fft -> kernel + (size_t) a*Ntheta*Nphi;
+        
+        for (k=0; k<Nphi; k++)
+            *(O + k) = 0.;
+        
+        for (b=0; b<Ntheta; b++)
+            for (k=0; k<Nphi; k++)
+                *(O + k) += *(K + b*Nphi + k) * *(fft -> transform + b*Nphi + k);
+    }
+    
+    for (a=0; a<Ntheta; a++)
+        gsl_fft_halfcomplex_inverse (out + a*Nphi, 1, Nphi, fft -> halfcomplex, fft -> work);
+}
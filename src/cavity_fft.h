@@ -0,0 +1,53 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __CAVITY_FFT_H__
+#define __CAVITY_FFT_H__
+
+#include <gsl/gsl_fft_real.h>
+#include <gsl/gsl_fft_halfcomplex.h>
+
+/* on a uniform periodic grid in phi, the kernel between two values theta = a and theta' = b */
+/* only depends on phi - phi', and its product with the marginal is a circular convolution in phi, */
+/* done in Fourier space. The transform of each block of the kernel is real, as the kernel is even in */
+/* phi - phi', and is stored in the halfcomplex layout of GSL with the real part repeated in place of */
+/* the (zero) imaginary part, so that the products are done element by element */
+typedef struct {
+    
+    int Ntheta;
+    int Nphi;
+    
+    /* transforms of the blocks of the kernel, stored as [(a*Ntheta + b)*Nphi + k] */
+    double *kernel;
+    
+    /* transforms of the rows of the marginal, one per value of theta */
+    double *transform;
+    
+    gsl_fft_real_wavetable *real;
+    gsl_fft_halfcomplex_wavetable *halfcomplex;
+    gsl_fft_real_workspace *work;
+    
+} cavity_fft;
+
+cavity_fft *cavity_fft_alloc (int, int);
+
+void cavity_fft_free (cavity_fft *);
+
+void cavity_fft_compute_kernel (cavity_fft *, const double *, const double *, double);
+
+void cavity_fft_product (cavity_fft *, const double *, double *);
+
+#endif
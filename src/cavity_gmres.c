@@ -0,0 +1,188 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <gsl/gsl_cblas.h>
+#include <gsl/gsl_errno.h>
+#include "cavity_macros.h"
+#include "cavity_gmres.h"
+#include "cavity_kernel.h"
+
+/******************************************************************
+ *                                                                *
+ *  Restarted GMRES for the tangent system of the cavity          *
+ *  equations. The operator lambda - A + P (w^T A), with          *
+ *  A = diag(field) * kernel, is only applied to vectors, so      *
+ *  that each step costs one product with the kernel and no       *
+ *  matrix other than the kernel is stored.                       *
+ *                                                                *
+ *****************************************************************/
+
+/* allocate the solver for a grid of n points */
+cavity_gmres *cavity_gmres_alloc (int n){
+    
+    cavity_gmres *gm = (cavity_gmres *) malloc (sizeof(cavity_gmres));
+    
+    gm -> n = n;
+    gm -> m = n < __GMRES_KRYLOV__ ? n : __GMRES_KRYLOV__;
+    
+    gm -> V = (double *) malloc ((size_t) (gm -> m+1)*n*sizeof(double));
+    gm -> H = (double *) malloc ((size_t) (gm -> m+1)*gm -> m*sizeof(double));
+    
+    gm -> cs = (double *) malloc (gm -> m*sizeof(double));
+    gm -> sn = (double *) malloc (gm -> m*sizeof(double));
+    gm -> g = (double *) malloc ((gm -> m+1)*sizeof(double));
+    
+    return gm;
+}
+
+/* free the memory of the solver */
+void cavity_gmres_free (cavity_gmres *gm){
+    
+    free (gm -> V);
+    free (gm -> H);
+    
+    free (gm -> cs);
+    free (gm -> sn);
+    free (gm -> g);
+    
+    free (gm);
+}
+
+/* y = lambda x - field * (kernel x) + marginal (wA^T x) */
+static void cavity_gmres_apply (const double *kernel, const double *field, const double *marginal, const double *wA, double lambda, const double *x, double *y, int n){
+    
+    int i;
+    double s = cblas_ddot (n, wA, 1, x, 1);
+    
+    cavity_kernel_product (kernel, x, 0., y, n);
+    
+    for (i=0; i<n; i++)
+        *(y+i) = lambda * *(x+i) - *(field+i) * *(y+i) + *(marginal+i) * s;
+}
+
+/* solve (lambda - diag(field) kernel + marginal wA^T) x = rhs, starting from the x given (e.g. the gradient */
+/* at the previous force), until the residual is below tol times the norm of rhs or after max_iter products */
+/* with the kernel, whose number is returned in iter. Returns GSL_CONTINUE if the residual is still above tol */
+int cavity_gmres_tangent (cavity_gmres *gm, const double *kernel, const double *field, const double *marginal, const double *wA, double lambda, const double *rhs, double *x, double tol, unsigned int max_iter, unsigned int *iter){
+    
+    int i, j, k, n = gm -> n, m = gm -> m;
+    double norm_rhs = cblas_dnrm2 (n, rhs, 1), beta, h, r, y, *v, *w, *H = gm -> H;
+    
+    *iter = 0;
+    
+    /* the tangent system is regular: a vanishing right hand side has the solution 0 */
+    if (norm_rhs == 0.){
+        
+        for (i=0; i<n; i++)
+            *(x+i) = 0.;
+        
+        return GSL_SUCCESS;
+    }
+    
+    while (1){
+        
+        /* residual rhs - T x of the current solution, as the first vector of the basis */
+        v = gm -> V;
+        
+        cavity_gmres_apply (kernel, field, marginal, wA, lambda, x, v, n);
+        
+        for (i=0; i<n; i++)
+            *(v+i) = *(rhs+i) - *(v+i);
+        
+        beta = cblas_dnrm2 (n, v, 1);
+        
+        if (beta <= tol*norm_rhs)
+            return GSL_SUCCESS;
+        
+        if (*iter >= max_iter)
+            return GSL_CONTINUE;
+        
+        cblas_dscal (n, 1./beta, v, 1);
+        
+        *(gm -> g) = beta;
+        
+        /* Arnoldi iteration, with the least squares problem triangularised by Givens rotations as it grows */
+        for (k=0; k<m && *iter<max_iter; ){
+            
+            (*iter)++;
+            
+            v = gm -> V + (size_t) k*n;
+            w = v + n;
+            
+            cavity_gmres_apply (kernel, field, marginal, wA, lambda, v, w, n);
+            
+            /* modified Gram-Schmidt against the basis */
+            for (j=0; j<=k; j++){
+                
+                h = cblas_ddot (n, w, 1, gm -> V + (size_t) j*n, 1);
+                cblas_daxpy (n, -h, gm -> V + (size_t) j*n, 1, w, 1);
+                
+                *(H + k*(m+1) + j) = h;
+            }
+            
+            h = cblas_dnrm2 (n, w, 1);
+            
+            *(H + k*(m+1) + k+1) = h;
+            
+            if (h > 0.)
+                cblas_dscal (n, 1./h, w, 1);
+            
+            /* rotations of the previous columns, then the one that eliminates the subdiagonal entry */
+            for (j=0; j<k; j++){
+                
+                y = *(gm -> cs+j) * *(H + k*(m+1) + j) + *(gm -> sn+j) * *(H + k*(m+1) + j+1);
+                
+                *(H + k*(m+1) + j+1) = - *(gm -> sn+j) * *(H + k*(m+1) + j) + *(gm -> cs+j) * *(H + k*(m+1) + j+1);
+                *(H + k*(m+1) + j) = y;
+            }
+            
+            r = hypot (*(H + k*(m+1) + k), h);
+            
+            if (r == 0.)
+                return GSL_ESING;
+            
+            *(gm -> cs+k) = *(H + k*(m+1) + k)/r;
+            *(gm -> sn+k) = h/r;
+            
+            *(H + k*(m+1) + k) = r;
+            
+            *(gm -> g+k+1) = - *(gm -> sn+k) * *(gm -> g+k);
+            *(gm -> g+k) *= *(gm -> cs+k);
+            
+            k++;
+            
+            /* the rotated residual is the norm of the residual of the least squares solution */
+            if (fabs(*(gm -> g+k)) <= tol*norm_rhs || h == 0.)
+                break;
+        }
+        
+        /* back-substitution of the triangular system, whose solution replaces g, and x += V g */
+        for (j=k-1; j>=0; j--){
+            
+            y = *(gm -> g+j);
+            
+            for (i=j+1; i<k; i++)
+                y -= *(H + i*(m+1) + j) * *(gm -> g+i);
+            
+            *(gm -> g+j) = y / *(H + j*(m+1) + j);
+        }
+        
+        for (j=0; j<k; j++)
+            cblas_daxpy (n, *(gm -> g+j), gm -> V + (size_t) j*n, 1, x, 1);
+    }
+}
@@ -0,0 +1,50 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CAVITY_GMRES_H__
+#define __CAVITY_GMRES_H__
+
+#include <stdlib.h>
+
+/* workspace of the restarted GMRES solver of the tangent system of the cavity equations, */
+/* (lambda - (1 - P w^T) A) dP = rhs, which gives the gradient of the converged marginal P */
+/* using only products with the kernel */
+typedef struct{
+    
+    int n;
+    
+    /* dimension of the Krylov space before GMRES is restarted */
+    int m;
+    
+    /* Arnoldi basis of m+1 vectors of n points, and the Hessenberg matrix stored by columns of m+1 entries */
+    double *V;
+    double *H;
+    
+    /* Givens rotations that triangularise the Hessenberg matrix, and the rotated residual */
+    double *cs;
+    double *sn;
+    double *g;
+    
+} cavity_gmres;
+
+cavity_gmres *cavity_gmres_alloc (int);
+
+void cavity_gmres_free (cavity_gmres *);
+
+int cavity_gmres_tangent (cavity_gmres *, const double *, const double *, const double *, const double *, double, const double *, double *, double, unsigned int, unsigned int *);
+
+#endif
@@ -18,12 +18,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <gsl/gsl_cblas.h>
+#include <gsl/gsl_errno.h>
 #include "cavity_macros.h"
 #include "cavity_gradient.h"
 #include "cavity_gradient_alloc.h"
 #include "cavity_gradient_init.h"
 #include "cavity_gradient_scalar.h"
 #include "cavity_integrate.h"
+#include "cavity_kernel.h"
 
 /******************************************************************
  *                                                                *
@@ -38,53 +41,125 @@
  *                                                                *
  *****************************************************************/
 
-/* integrate exp(J * t * u) * f (u) over u (i.e. angles theta and phi) */
+/* integrate exp(J * t * u) * f (u) over u (i.e. angles theta and phi) for all values of t */
 /* integral in Eq. (9) of Massucci et al. 2014 */
-double cavity_integrate_marginal_and_gradient_bB (cavity_gradient_workspace *cav_w, double *p_c, double JB, int INIT) {
+/* the quadrature weights and the Boltzmann factor are stored in the kernel */
+void cavity_integrate_marginal_and_gradient_bB (cavity_gradient_workspace *cav_w, const double *p_c, double *integral) {
     
-    double *s, integral=0.;
-    int i=0;
+    cavity_kernel_product (cav_w -> kernel, p_c, 0., integral, cav_w -> npoints);
+}
+
+/* integrate exp(J * t * u) * df (u)/(d JB) over u (i.e. angles theta and phi) for all values of t */
+/* first integral in Eq. (15) of Massucci et al. 2014 */
+/* the term t*u * exp(J * t*u) * f(u) is handled by the derivative of the kernel wrt JB */
+void cavity_integrate_gradient_JB_marginal (cavity_gradient_workspace *cav_w, const double *p_c, const double *dp_c_db, double *integral) {
     
-    for (s=cav_w -> scalar_prod+INIT; s<cav_w -> scalar_prod+INIT+__Ntheta__*__Nphi__; s++){
-        
-        /* weights fort theta and phi are stored in w_theta and w_phi, respectively */
-        /* i/__Nphi__ gives the (index of) angle theta and i%__Nphi__ the one of phi */
-        integral += *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__) *exp(*s*JB) * *(p_c + i);
-        
-        i++;
-        
-    }
+    cavity_kernel_product (cav_w -> kernel_JB, p_c, 0., integral, cav_w -> npoints);
     
-    return integral;
+    cavity_kernel_product (cav_w -> kernel, dp_c_db, 1., integral, cav_w -> npoints);
 }
 
-/* integrate exp(J * t * u) * df (u)/(d JB) over u (i.e. angles theta and phi) */
-/* first integral in Eq. (15) of Massucci et al. 2014 */
-double cavity_integrate_gradient_JB_marginal (cavity_gradient_workspace *cav_w, double *p_c, double *dp_c_db, double JB, int INIT) {
+/* gradient of the converged marginal P wrt the parameters bB, JB by implicit differentiation of Eq. (9) */
+/* of Massucci et al. (2014). Writing Eq. (9) as lambda P = A P, with A = field * kernel and the normalisation */
+/* lambda = sum_i w_i (A P)_i, the derivatives dP solve (lambda - (1 - P w^T) A) dP = (1 - P w^T) dA P, */
+/* where dA P = f * z*t * field * I(t) for bB and field * I_JB(t) for JB. Both are solved by GMRES, */
+/* starting from the derivatives of the previous call */
+static int cavity_solve_gradient_tangent (cavity_gradient_workspace *cav_w, double f){
+    
+    int i, n = cav_w -> npoints, status;
+    unsigned int iter;
+    double lambda=0., r_bB=0., r_JB=0., *wA = cav_w -> marginal_dummy;
+    
+    /* I(t) and I_JB(t) of the converged marginal */
+    cavity_integrate_marginal_and_gradient_bB (cav_w, cav_w -> marginal, cav_w -> integral);
     
-    double *s, integral=0.;
-    int i=0;
+    cavity_kernel_product (cav_w -> kernel_JB, cav_w -> marginal, 0., cav_w -> d_integral_dJB, n);
     
-    for (s=cav_w -> scalar_prod+INIT; s<cav_w -> scalar_prod+INIT+__Ntheta__*__Nphi__; s++){
+    /* right hand sides dA P, with their normalisation, and the normalisation lambda of A P */
+    for (i=0; i<n; i++){
         
-        /* weights fort theta and phi are stored in w_theta and w_phi, respectively */
-        /* i/__Nphi__ gives the (index of) angle theta and i%__Nphi__ the one of phi */
-        integral += *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__) *exp(*s*JB) * (*s* (*(p_c + i)) + *(dp_c_db+i)) ;
+        *(cav_w -> d_marginal_dbB_dummy + i) = f * *(cav_w -> cos_theta + i/cav_w -> Nphi) * *(cav_w -> field + i) * *(cav_w -> integral + i);
+        *(cav_w -> d_marginal_dJB_dummy + i) = *(cav_w -> field + i) * *(cav_w -> d_integral_dJB + i);
         
-        i++;
+        lambda += *(cav_w -> weight + i) * *(cav_w -> field + i) * *(cav_w -> integral + i);
+        r_bB += *(cav_w -> weight + i) * *(cav_w -> d_marginal_dbB_dummy + i);
+        r_JB += *(cav_w -> weight + i) * *(cav_w -> d_marginal_dJB_dummy + i);
+    }
+    
+    /* project them on the normalised marginals, (1 - P w^T) dA P */
+    for (i=0; i<n; i++){
         
+        *(cav_w -> d_marginal_dbB_dummy + i) -= *(cav_w -> marginal + i) * r_bB;
+        *(cav_w -> d_marginal_dJB_dummy + i) -= *(cav_w -> marginal + i) * r_JB;
     }
     
-    return integral;
+    /* the row w^T A = kernel^T (w * field), kept in the spare marginal; w * field is stored */
+    /* in the integral of the derivative wrt bB, which the implicit differentiation does not use */
+    for (i=0; i<n; i++)
+        *(cav_w -> d_integral_dbB + i) = *(cav_w -> weight + i) * *(cav_w -> field + i);
+    
+    cblas_dgemv (CblasRowMajor, CblasTrans, n, n, 1., cav_w -> kernel, n, cav_w -> d_integral_dbB, 1, 0., wA, 1);
+    
+    cav_w -> lambda = lambda;
+    
+    status = cavity_gmres_tangent (cav_w -> gmres, cav_w -> kernel, cav_w -> field, cav_w -> marginal, wA, lambda, cav_w -> d_marginal_dbB_dummy, cav_w -> d_marginal_dbB, cav_w -> tol, cav_w -> max_iter, &iter);
+    
+    if (status == GSL_SUCCESS)
+        status = cavity_gmres_tangent (cav_w -> gmres, cav_w -> kernel, cav_w -> field, cav_w -> marginal, wA, lambda, cav_w -> d_marginal_dJB_dummy, cav_w -> d_marginal_dJB, cav_w -> tol, cav_w -> max_iter, &iter);
+    
+    return status;
 }
 
 /* Iterate the equations for the cavity marginals and their gradient wrt to the parameters bB, JB */
 /* This solves Eqs. (9) and (15) of Massucci et al. (2014) */
-void cavity_iterate_gradient_marginal_equations (cavity_gradient_workspace *cav_w, double f, double bB, double JB){
+int cavity_iterate_gradient_marginal_equations (cavity_gradient_workspace *cav_w, double f, double bB, double JB){
+    
+    
+    int i, status;
+    unsigned int iter=0;
+    double error, *P, *p1, *p2, *dp1_dbB, *dp2_dbB, *dp1_dJB, *dp2_dJB, Z, dZ_dbB, dZ_dJB, field, cos_theta, change;
+    
+    /* with the implicit differentiation only the marginal is iterated */
+    int co_iterate = cav_w -> gmres == NULL;
     
+    /* the changes are weighted by the quadrature; the test on the observables is left to the iteration of rho */
+    int weighted = cav_w -> criterion & WLC_CAVITY_WEIGHTED;
     
-    int i;
-    double error, *P, *p1, *p2, *dp1_dbB, *dp2_dbB, *dp1_dJB, *dp2_dJB, Z, dZ_dbB, dZ_dJB, integral, d_integral_dbB, d_integral_dJB;
+    /* on an adaptive grid, the points in cos(theta) follow the force */
+    cavity_gradient_stretch_grid (cav_w, f, bB);
+    
+    /* the Boltzmann kernel, its derivative and the field factor do not change during the iteration: compute them once */
+    /* the kernels only depend on JB, and are kept from the previous call if JB did not change */
+    if (!cav_w -> kernel_ready || cav_w -> JB != JB){
+        
+        if (cav_w -> axisymmetric){
+            cavity_compute_kernel_axisymmetric (cav_w -> kernel, cav_w -> cos_theta, cav_w -> weight, JB, cav_w -> Ntheta);
+            cavity_compute_kernel_JB_axisymmetric (cav_w -> kernel_JB, cav_w -> cos_theta, cav_w -> weight, JB, cav_w -> Ntheta);
+        }
+        else {
+            cavity_compute_kernel (cav_w -> kernel, cav_w -> scalar_prod, cav_w -> weight, JB, cav_w -> npoints);
+            cavity_compute_kernel_JB (cav_w -> kernel_JB, cav_w -> scalar_prod, cav_w -> kernel, cav_w -> npoints);
+        }
+        
+        cav_w -> JB = JB;
+        cav_w -> kernel_ready = 1;
+    }
+    
+    cav_w -> log_scale = fabs(JB) + cavity_compute_field (cav_w -> field, cav_w -> cos_theta, f, bB, cav_w -> Ntheta, cav_w -> Nphi);
+    
+    /* the eigen-solver obtains the marginal directly, starting from the current one: */
+    /* the iteration below then only has to converge the gradient */
+    if (cav_w -> eigen){
+        
+        if (cavity_eigen_marginal (cav_w -> eigen, cav_w -> kernel, cav_w -> field, cav_w -> weight, cav_w -> tol, cav_w -> max_iter, cav_w -> marginal, &cav_w -> lambda, &cav_w -> iter)!=GSL_SUCCESS)
+            return GSL_CONTINUE;
+        
+        /* or is not needed at all */
+        if (!co_iterate)
+            return cavity_solve_gradient_tangent (cav_w, f);
+        
+        iter = cav_w -> iter;
+    }
     
     /* The equations are iterated recursively. 2 arrays for the cavity marginal are used and swapped at each iteration */
     /* the gradient is trated similarly */
@@ -98,10 +173,24 @@ void cavity_iterate_gradient_marginal_equations (cavity_gradient_workspace *cav_
     dp1_dJB = cav_w-> d_marginal_dJB;
     dp2_dJB = cav_w-> d_marginal_dJB_dummy;
     
+    /* the history of the accelerated iteration belongs to the previous call */
+    if (cav_w -> anderson)
+        cavity_anderson_reset (cav_w -> anderson);
+    
     
     
     do {
         
+        iter++;
+        
+        /* Perform the integrals of the cavity equations using Gaussian quadratures */
+        cavity_integrate_marginal_and_gradient_bB (cav_w, p1, cav_w -> integral);
+        
+        if (co_iterate){
+            cavity_integrate_marginal_and_gradient_bB (cav_w, dp1_dbB, cav_w -> d_integral_dbB);
+            cavity_integrate_gradient_JB_marginal (cav_w, p1, dp1_dJB, cav_w -> d_integral_dJB);
+        }
+        
         /* initialise the normalising factor and its derivative with respect to b_B and J_B */
         Z=0.;
         dZ_dbB =0.;
@@ -113,22 +202,25 @@ void cavity_iterate_gradient_marginal_equations (cavity_gradient_workspace *cav_
         /* The cavity marginal depends on angles theta and phi */
         /* It is discretised in Ntheta x Nphi points */
         
-        for(P = p2; P<p2+__Ntheta__*__Nphi__;P++){
+        for(P = p2; P<p2+cav_w -> npoints;P++){
             
-            /* Perform the integrals of the cavity equations using Gaussian quadratures */
-            integral = cavity_integrate_marginal_and_gradient_bB (cav_w, p1, JB, i*__Ntheta__*__Nphi__);
-            d_integral_dbB = cavity_integrate_marginal_and_gradient_bB (cav_w, dp1_dbB, JB, i*__Ntheta__*__Nphi__);
-            d_integral_dJB = cavity_integrate_gradient_JB_marginal (cav_w, p1, dp1_dJB, JB, i*__Ntheta__*__Nphi__);
+            field = *(cav_w -> field + i);
+            cos_theta = *(cav_w -> cos_theta+ i/cav_w -> Nphi);
             
             /* P = exp (b_B * f * z*t) * Integral(t) */
-            *P = exp(f* *(cav_w -> cos_theta+ i/__Nphi__)*bB)*integral;
-            *(dp2_dbB+i) = exp(f* *(cav_w -> cos_theta+ i/__Nphi__)*bB) * (f * integral* *(cav_w -> cos_theta+ i/__Nphi__) + d_integral_dbB);
-            *(dp2_dJB+i) = exp(f* *(cav_w -> cos_theta+ i/__Nphi__)*bB) * d_integral_dJB;
+            *P = field * *(cav_w -> integral + i);
             
             /* increase the normalization */
-            Z += *P * *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__);
-            dZ_dbB += *(dp2_dbB+i) * *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__);
-            dZ_dJB += *(dp2_dJB+i) * *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__);
+            Z += *P * *(cav_w -> weight + i);
+            
+            if (co_iterate){
+                
+                *(dp2_dbB+i) = field * (f * *(cav_w -> integral + i) * cos_theta + *(cav_w -> d_integral_dbB + i));
+                *(dp2_dJB+i) = field * *(cav_w -> d_integral_dJB + i);
+                
+                dZ_dbB += *(dp2_dbB+i) * *(cav_w -> weight + i);
+                dZ_dJB += *(dp2_dJB+i) * *(cav_w -> weight + i);
+            }
             
             i++;
         }
@@ -139,20 +231,43 @@ void cavity_iterate_gradient_marginal_equations (cavity_gradient_workspace *cav_
         
         i = 0;
         
-        for(P = p2; P<p2+__Ntheta__*__Nphi__;P++){
+        for(P = p2; P<p2+cav_w -> npoints;P++){
             
             *P /= Z;
             
-            *(dp2_dbB+i) = *(dp2_dbB+i)/Z - *P * dZ_dbB/Z;
+            change = fabs(*P-*(p1+i));
             
-            *(dp2_dJB+i) = *(dp2_dJB+i)/Z - *P * dZ_dJB/Z;
+            if (co_iterate){
+                
+                *(dp2_dbB+i) = *(dp2_dbB+i)/Z - *P * dZ_dbB/Z;
+                
+                *(dp2_dJB+i) = *(dp2_dJB+i)/Z - *P * dZ_dJB/Z;
+                
+                change+=fabs(*(dp2_dbB+i)-*(dp1_dbB+i)) + fabs(*(dp2_dJB+i)-*(dp1_dJB+i));
+            }
             
-            error+=fabs(*P-*(p1+i)) + fabs(*(dp2_dbB+i)-*(dp1_dbB+i)) + fabs(*(dp2_dJB+i)-*(dp1_dJB+i));
+            error += weighted ? change * *(cav_w -> weight + i) : change;
             
             i++;
             
         }
         
+        /* accelerate the iteration by mixing the new marginals with the previous iterations */
+        if (cav_w -> anderson && error>cav_w -> tol){
+            
+            double *x[3], *g[3];
+            
+            x[0] = p1;
+            x[1] = dp1_dbB;
+            x[2] = dp1_dJB;
+            
+            g[0] = p2;
+            g[1] = dp2_dbB;
+            g[2] = dp2_dJB;
+            
+            cavity_anderson_mix (cav_w -> anderson, x, g);
+        }
+        
         /* swap p1, p2 for further iteration */
         P = p2;
         
@@ -178,5 +293,29 @@ void cavity_iterate_gradient_marginal_equations (cavity_gradient_workspace *cav_
     }
     
     /* repeat until convergence */
-    while(error>__TOL__);
+    while(error>cav_w -> tol && iter<cav_w -> max_iter);
+    
+    /* keep the last iterate in the marginals, to be used for the observables */
+    /* and as the starting point of a following call (e.g. at a nearby force) */
+    cav_w -> marginal = p1;
+    cav_w -> marginal_dummy = p2;
+    
+    cav_w -> d_marginal_dbB = dp1_dbB;
+    cav_w -> d_marginal_dbB_dummy = dp2_dbB;
+    
+    cav_w -> d_marginal_dJB = dp1_dJB;
+    cav_w -> d_marginal_dJB_dummy = dp2_dJB;
+    
+    cav_w -> iter = iter;
+    cav_w -> lambda = Z;
+    
+    /* signal if the iteration stopped before reaching convergence */
+    if (error>cav_w -> tol)
+        return GSL_CONTINUE;
+    
+    /* the gradient of the converged marginal */
+    if (!co_iterate && (status = cavity_solve_gradient_tangent (cav_w, f))!=GSL_SUCCESS)
+        return status;
+    
+    return GSL_SUCCESS;
 }
@@ -19,9 +19,64 @@
 #define __CAVITY_GRADIENT_LIB_H__
 
 #include "cavity_macros.h"
+#include "wlc.h"
+#include "cavity_anderson.h"
+#include "cavity_eigen.h"
+#include "cavity_gmres.h"
+#include "cavity_lebedev.h"
 
 typedef struct{
     
+    /* size of the grid on which the marginal is discretised: Ntheta x Nphi = npoints */
+    /* an axisymmetric marginal does not depend on phi and is discretised on Ntheta x 1 points */
+    int Ntheta;
+    int Nphi;
+    int npoints;
+    int axisymmetric;
+    
+    /* a periodic grid is uniform in phi (trapezoidal rule) instead of Gauss-Legendre */
+    int periodic;
+    
+    /* a Lebedev grid is an unstructured list of npoints = Ntheta points on the sphere, with Nphi = 1: */
+    /* the point i has its own cos(theta), phi and weight in cos_theta, phi and w_cos_theta */
+    int lebedev;
+    
+    /* on an adaptive grid, the points in cos(theta) are stretched towards the force axis by a */
+    /* parameter that depends on f*bB (see stretch_parameter); stretch is its current value */
+    int adaptive;
+    double stretch;
+    
+    /* tolerance and maximum number of iterations of the cavity equations, and the convergence test */
+    /* (a combination of WLC_CAVITY_WEIGHTED and WLC_CAVITY_OBSERVABLES, see wlc_cavity_params) */
+    double tol;
+    unsigned int max_iter;
+    int criterion;
+    
+    /* value of JB for which the kernel has been computed, if kernel_ready is set */
+    double JB;
+    int kernel_ready;
+    
+    /* number of iterations done by the last call to the iteration routine, and its status */
+    unsigned int iter;
+    int status;
+    
+    /* history for the Anderson acceleration, NULL for the plain iteration */
+    cavity_anderson *anderson;
+    
+    /* eigen-solver of the cavity equations, NULL for the iteration */
+    cavity_eigen *eigen;
+    
+    /* normalisation of the marginal at the fixed point, i.e. the leading eigenvalue of the transfer operator */
+    double lambda;
+    
+    /* the kernel and the field are scaled by exp(-log_scale), log_scale = |JB| + |b_B f| z_max, so that */
+    /* they are at most 1 whatever JB and f: the eigenvalue of the unscaled operator is lambda exp(log_scale) */
+    double log_scale;
+    
+    /* GMRES solver of the linear tangent system of the fixed point, which gives the gradient */
+    /* once the marginal has converged. NULL when the gradient is iterated together with the marginal */
+    cavity_gmres *gmres;
+    
     /* arrays for 2 cavity marginals to be iterated*/
     double *marginal;
     double *marginal_dummy;
@@ -43,9 +98,27 @@ typedef struct{
     /*arrays for scalar product values */
     double *scalar_prod;
     
+    /*array for the quadrature weight of each grid point */
+    double *weight;
+    
+    /*arrays for the Boltzmann kernel w(u) * exp(J * t*u) and its derivative wrt JB */
+    double *kernel;
+    double *kernel_JB;
+    
+    /*array for the external field factor exp(b_B * f * z*t) */
+    double *field;
+    
+    /*arrays for the integrals of the kernel times the marginal and its derivatives */
+    double *integral;
+    double *d_integral_dbB;
+    double *d_integral_dJB;
+    
     /* the persistence length at fixed force */
     double xi;
     
+    /* variance of z*t, the connected self-correlation of Eq. (13) of Massucci et al. (2014) */
+    double variance;
+    
     /* gradient wrt the parameters bB, JB */
     double dLdbB;
     double dLdJB;
@@ -55,10 +128,10 @@ typedef struct{
 #include "cavity_gradient_alloc.h"
 #include "cavity_gradient_init.h"
 
-double cavity_integrate_marginal_and_gradient_bB (cavity_gradient_workspace *, double *, double, int);
+void cavity_integrate_marginal_and_gradient_bB (cavity_gradient_workspace *, const double *, double *);
 
-double cavity_integrate_gradient_JB_marginal (cavity_gradient_workspace *, double *, double *, double, int);
+void cavity_integrate_gradient_JB_marginal (cavity_gradient_workspace *, const double *, const double *, double *);
 
-void cavity_iterate_gradient_marginal_equations (cavity_gradient_workspace *, double, double, double);
+int cavity_iterate_gradient_marginal_equations (cavity_gradient_workspace *, double, double, double);
 
 #endif
@@ -15,35 +15,88 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <gsl/gsl_errno.h>
+#include "cavity_alloc.h"
 #include "cavity_gradient_alloc.h"
 
 /* allocate the memory for the cavity workspace with its gradient arrays */
-cavity_gradient_workspace *cavity_gradient_workspace_alloc (void){
+cavity_gradient_workspace *cavity_gradient_workspace_alloc (const wlc_cavity_params *params){
     cavity_gradient_workspace *cav_wspace;
     
     cav_wspace = (cavity_gradient_workspace *) malloc (sizeof(cavity_gradient_workspace));
     
+    /* set the size of the grid and the parameters of the iteration */
+    /* an axisymmetric marginal is discretised on a single point in phi, as is the spectral one */
+    cav_wspace -> axisymmetric = params -> axisymmetric || params -> spectral;
+    
+    /* a Lebedev grid replaces the tensor grid of a marginal that depends on phi */
+    cav_wspace -> lebedev = params -> lebedev && !cav_wspace -> axisymmetric;
+    
+    cav_wspace -> Ntheta = cav_wspace -> lebedev ? params -> lebedev : params -> Ntheta;
+    cav_wspace -> Nphi = cav_wspace -> axisymmetric || cav_wspace -> lebedev ? 1 : params -> Nphi;
+    cav_wspace -> npoints = cav_wspace -> Ntheta * cav_wspace -> Nphi;
+    
+    cavity_check_params ("cavity_gradient_workspace_alloc", params, cav_wspace -> lebedev, cav_wspace -> Ntheta, cav_wspace -> Nphi);
+    
+    cav_wspace -> periodic = params -> periodic && !cav_wspace -> axisymmetric && !cav_wspace -> lebedev;
+    
+    /* the grid in cos(theta) of the spectral products is fixed */
+    cav_wspace -> adaptive = params -> adaptive && !params -> spectral && !cav_wspace -> lebedev;
+    
+    cav_wspace -> tol = params -> tol;
+    cav_wspace -> max_iter = params -> max_iter;
+    cav_wspace -> criterion = params -> criterion;
+    cav_wspace -> status = GSL_SUCCESS;
+    
+    /* the Anderson acceleration mixes the marginal and its two derivatives, */
+    /* or only the marginal when the gradient is obtained by implicit differentiation */
+    cav_wspace -> anderson = params -> anderson ? cavity_anderson_alloc (cav_wspace -> npoints, params -> implicit ? 1 : 3, params -> anderson) : NULL;
+    
+    /* the eigen-solver replaces the iteration of the marginal */
+    cav_wspace -> eigen = params -> eigen ? cavity_eigen_alloc (cav_wspace -> npoints) : NULL;
+    
+    /* the implicit differentiation solves a linear system on the grid with products with the kernel */
+    cav_wspace -> gmres = params -> implicit ? cavity_gmres_alloc (cav_wspace -> npoints) : NULL;
+    
     /* allocate space for the cavity marginals and their derivatives to iterate */
-    cav_wspace -> marginal = __ALLOC_MARGINAL__;
-    cav_wspace -> marginal_dummy = __ALLOC_MARGINAL__;
+    cav_wspace -> marginal = __ALLOC_MARGINAL__(cav_wspace);
+    cav_wspace -> marginal_dummy = __ALLOC_MARGINAL__(cav_wspace);
     
-    cav_wspace -> d_marginal_dbB = __ALLOC_MARGINAL__;
-    cav_wspace -> d_marginal_dbB_dummy = __ALLOC_MARGINAL__;
+    cav_wspace -> d_marginal_dbB = __ALLOC_MARGINAL__(cav_wspace);
+    cav_wspace -> d_marginal_dbB_dummy = __ALLOC_MARGINAL__(cav_wspace);
     
-    cav_wspace -> d_marginal_dJB = __ALLOC_MARGINAL__;
-    cav_wspace -> d_marginal_dJB_dummy = __ALLOC_MARGINAL__;
+    cav_wspace -> d_marginal_dJB = __ALLOC_MARGINAL__(cav_wspace);
+    cav_wspace -> d_marginal_dJB_dummy = __ALLOC_MARGINAL__(cav_wspace);
     
     /* allocate cos(theta) and weights for the Gauss-Legendre integration */
-    cav_wspace -> cos_theta = __ALLOC_COS_THETA__;
+    cav_wspace -> cos_theta = __ALLOC_COS_THETA__(cav_wspace);
     
-    cav_wspace -> w_cos_theta = __ALLOC_COS_THETA__;
+    cav_wspace -> w_cos_theta = __ALLOC_COS_THETA__(cav_wspace);
     
     /* allocate phi and weights for the Gauss-Legendre integration */
-    cav_wspace -> phi = __ALLOC_PHI__;
-    cav_wspace -> w_phi = __ALLOC_PHI__;
+    cav_wspace -> phi = cav_wspace -> lebedev ? __ALLOC_COS_THETA__(cav_wspace) : __ALLOC_PHI__(cav_wspace);
+    cav_wspace -> w_phi = __ALLOC_PHI__(cav_wspace);
     
-    /* allocate memory for the scalar product */
-    cav_wspace -> scalar_prod = __ALLOC_SCALAR_PRODUCT__;
+    /* allocate memory for the scalar product, which the axisymmetric kernel does not need */
+    cav_wspace -> scalar_prod = cav_wspace -> axisymmetric ? NULL : __ALLOC_SCALAR_PRODUCT__(cav_wspace);
+    
+    /* allocate the quadrature weights and the field factor on the grid */
+    cav_wspace -> weight = __ALLOC_MARGINAL__(cav_wspace);
+    cav_wspace -> field = __ALLOC_MARGINAL__(cav_wspace);
+    
+    /* allocate memory for the Boltzmann kernel */
+    cav_wspace -> kernel = __ALLOC_KERNEL__(cav_wspace);
+    cav_wspace -> kernel_JB = __ALLOC_KERNEL__(cav_wspace);
+    
+    /* allocate the integrals of the kernel */
+    cav_wspace -> integral = __ALLOC_MARGINAL__(cav_wspace);
+    cav_wspace -> d_integral_dbB = __ALLOC_MARGINAL__(cav_wspace);
+    cav_wspace -> d_integral_dJB = __ALLOC_MARGINAL__(cav_wspace);
+    
+    /* the grids are combined with the precedence above: report those that are not used */
+    cavity_report_dropped ("cavity_gradient_workspace_alloc", "lebedev", params -> lebedev, cav_wspace -> lebedev, "with axisymmetric or spectral");
+    cavity_report_dropped ("cavity_gradient_workspace_alloc", "periodic", params -> periodic, cav_wspace -> periodic, "with axisymmetric, spectral or lebedev");
+    cavity_report_dropped ("cavity_gradient_workspace_alloc", "adaptive", params -> adaptive, cav_wspace -> adaptive, "with spectral or lebedev");
     
     return cav_wspace;
 }
@@ -74,6 +127,31 @@ void cavity_gradient_workspace_free (cavity_gradient_workspace *cav_wspace){
     /* free the scalar product */
     free(cav_wspace -> scalar_prod);
     
+    /* free weights and field factor */
+    free(cav_wspace -> weight);
+    free(cav_wspace -> field);
+    
+    /* free the Boltzmann kernel */
+    free(cav_wspace -> kernel);
+    free(cav_wspace -> kernel_JB);
+    
+    /* free the integrals of the kernel */
+    free(cav_wspace -> integral);
+    free(cav_wspace -> d_integral_dbB);
+    free(cav_wspace -> d_integral_dJB);
+    
+    /* free the history of the Anderson acceleration */
+    if (cav_wspace -> anderson)
+        cavity_anderson_free (cav_wspace -> anderson);
+    
+    /* and the eigen-solver */
+    if (cav_wspace -> eigen)
+        cavity_eigen_free (cav_wspace -> eigen);
+    
+    /* and the solver of the tangent system */
+    if (cav_wspace -> gmres)
+        cavity_gmres_free (cav_wspace -> gmres);
+    
     /* free the workspace */
     free(cav_wspace);
 }
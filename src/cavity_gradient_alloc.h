@@ -22,7 +22,7 @@
 #include "cavity_macros.h"
 #include "cavity_gradient.h"
 
-cavity_gradient_workspace *cavity_gradient_workspace_alloc ();
+cavity_gradient_workspace *cavity_gradient_workspace_alloc (const wlc_cavity_params *);
 
 void cavity_gradient_workspace_free (cavity_gradient_workspace *);
 #endif
@@ -22,37 +22,37 @@ void cavity_gradient_initialise_marginal (cavity_gradient_workspace *cav_w){
     
     double *p;
     
-    for (p = cav_w -> marginal; p < cav_w -> marginal+__Ntheta__*__Nphi__; p++){
+    for (p = cav_w -> marginal; p < cav_w -> marginal+cav_w -> npoints; p++){
         
         /* initialise with uniform distribution in the unitary sphere */
         *p = 1./M_PI;
     }
     
-    for (p = cav_w -> marginal_dummy; p < cav_w -> marginal_dummy+__Ntheta__*__Nphi__; p++){
+    for (p = cav_w -> marginal_dummy; p < cav_w -> marginal_dummy+cav_w -> npoints; p++){
         
         /* initialise with uniform distribution in the unitary sphere */
         *p = 1./M_PI;
     }
     
-    for (p = cav_w -> d_marginal_dbB; p < cav_w -> d_marginal_dbB+__Ntheta__*__Nphi__; p++){
+    for (p = cav_w -> d_marginal_dbB; p < cav_w -> d_marginal_dbB+cav_w -> npoints; p++){
         
         /* initialise with uniform distribution in the unitary sphere */
         *p = 1./M_PI;
     }
     
-    for (p = cav_w -> d_marginal_dbB_dummy; p < cav_w -> d_marginal_dbB_dummy+__Ntheta__*__Nphi__; p++){
+    for (p = cav_w -> d_marginal_dbB_dummy; p < cav_w -> d_marginal_dbB_dummy+cav_w -> npoints; p++){
         
         /* initialise with uniform distribution in the unitary sphere */
         *p = 1./M_PI;
     }
     
-    for (p = cav_w -> d_marginal_dJB; p < cav_w -> d_marginal_dJB+__Ntheta__*__Nphi__; p++){
+    for (p = cav_w -> d_marginal_dJB; p < cav_w -> d_marginal_dJB+cav_w -> npoints; p++){
         
         /* initialise with uniform distribution in the unitary sphere */
         *p = 1./M_PI;
     }
     
-    for (p = cav_w -> d_marginal_dJB_dummy; p < cav_w -> d_marginal_dJB_dummy+__Ntheta__*__Nphi__; p++){
+    for (p = cav_w -> d_marginal_dJB_dummy; p < cav_w -> d_marginal_dJB_dummy+cav_w -> npoints; p++){
         
         /* initialise with uniform distribution in the unitary sphere */
         *p = 1./M_PI;
@@ -63,14 +63,73 @@ void cavity_gradient_initialise_marginal (cavity_gradient_workspace *cav_w){
 
 void cavity_gradient_workspace_initialise (cavity_gradient_workspace *cav_w){
     
-    /* assign values and weights to be used in the Gauss-Legendre integration to cos(theta) and phi */
-    abs_and_weights(-1,1, cav_w->cos_theta, cav_w->w_cos_theta,__Ntheta__);
+    if (cav_w -> lebedev){
+        
+        /* assign cos(theta), phi and weight of each point of the Lebedev grid; */
+        /* the weights of the points are carried by w_cos_theta alone */
+        cavity_lebedev_grid (cav_w -> npoints, cav_w->cos_theta, cav_w->phi, cav_w->w_cos_theta);
+        *(cav_w -> w_phi) = 1.;
+    }
+    else
+        /* assign values and weights to be used in the Gauss-Legendre integration to cos(theta) */
+        abs_and_weights(-1,1, cav_w->cos_theta, cav_w->w_cos_theta,cav_w -> Ntheta);
+    
+    if (cav_w -> axisymmetric){
+        
+        /* the marginal does not depend on phi: the integral over phi gives a factor 2 pi */
+        *(cav_w -> phi) = 0.;
+        *(cav_w -> w_phi) = 2*M_PI;
+    }
+    else if (cav_w -> periodic)
+        /* assign values and weights of the trapezoidal rule, spectrally accurate for a periodic function */
+        periodic_abs_and_weights(0,2*M_PI,cav_w->phi,cav_w->w_phi,cav_w -> Nphi);
+    else if (!cav_w -> lebedev)
+        /* assign values and weights to be used in the Gauss-Legendre integration to phi */
+        abs_and_weights(0,2*M_PI,cav_w->phi,cav_w->w_phi,cav_w -> Nphi);
     
-    abs_and_weights(0,2*M_PI,cav_w->phi,cav_w->w_phi,__Nphi__);
+    /* and the weight of each point of the grid */
+    cavity_compute_weights (cav_w->weight, cav_w->w_cos_theta, cav_w->w_phi, cav_w -> Ntheta, cav_w -> Nphi);
     
     /* compute the scalar product t*u to be used within the integral in the different cavity routines */
-    cavity_gradient_compute_scalar_products (cav_w);
+    /* the axisymmetric kernel is computed from cos(theta) only and does not need them */
+    if (!cav_w -> axisymmetric)
+        cavity_gradient_compute_scalar_products (cav_w);
+    
+    /* the kernel has to be computed by the first iteration */
+    cav_w -> kernel_ready = 0;
+    
+    /* the points in cos(theta) are not stretched yet */
+    cav_w -> stretch = 0.;
     
     /* initialise the cavity marginal */
     cavity_gradient_initialise_marginal (cav_w);
 }
+
+/* on an adaptive grid, move the points in cos(theta) to the stretch of the force f, bB */
+/* if it differs from the current one, and recompute all that depends on them */
+void cavity_gradient_stretch_grid (cavity_gradient_workspace *cav_w, double f, double bB){
+    
+    double stretch;
+    
+    if (!cav_w -> adaptive)
+        return;
+    
+    stretch = stretch_parameter (f, bB);
+    
+    if (stretch == cav_w -> stretch)
+        return;
+    
+    cav_w -> stretch = stretch;
+    
+    stretched_abs_and_weights (stretch, cav_w->cos_theta, cav_w->w_cos_theta, cav_w -> Ntheta);
+    
+    cavity_compute_weights (cav_w->weight, cav_w->w_cos_theta, cav_w->w_phi, cav_w -> Ntheta, cav_w -> Nphi);
+    
+    if (!cav_w -> axisymmetric)
+        cavity_gradient_compute_scalar_products (cav_w);
+    
+    cav_w -> kernel_ready = 0;
+    
+    /* the marginals on the previous points are no starting point on the new ones */
+    cavity_gradient_initialise_marginal (cav_w);
+}
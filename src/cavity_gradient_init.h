@@ -21,10 +21,12 @@
 #include <math.h>
 #include "cavity_macros.h"
 #include "cavity_integrate.h"
+#include "cavity_kernel.h"
 #include "cavity_gradient.h"
 #include "cavity_gradient_scalar.h"
 
 void cavity_gradient_initialise_marginal (cavity_gradient_workspace *);
 void cavity_gradient_workspace_initialise (cavity_gradient_workspace *);
+void cavity_gradient_stretch_grid (cavity_gradient_workspace *, double, double);
 
 #endif
@@ -21,17 +21,20 @@
 void cavity_gradient_compute_scalar_products (cavity_gradient_workspace *cav_w) {
     
     double *s, cos_theta1, cos_theta2, phi1, phi2, cos_phi1_phi2;
-    int i=0;
+    int Nphi = cav_w -> Nphi;
     
-    for (s= cav_w -> scalar_prod; s < cav_w -> scalar_prod+__Ntheta__*__Nphi__* __Ntheta__*__Nphi__; s++){
+    /* the array has npoints^2 entries, which overflows an int beyond 46340 points */
+    size_t i=0, npoints = cav_w -> npoints;
+    
+    for (s= cav_w -> scalar_prod; s < cav_w -> scalar_prod+npoints*npoints; s++){
         
         /* compute cos(theta) and cos(theta') */
-        cos_theta1 = *( cav_w -> cos_theta + i/(__Nphi__*__Ntheta__*__Nphi__));
-        cos_theta2 = *( cav_w -> cos_theta + (i%(__Ntheta__*__Nphi__))/__Nphi__);
+        cos_theta1 = *( cav_w -> cos_theta + i/(Nphi*npoints));
+        cos_theta2 = *( cav_w -> cos_theta + (i%npoints)/Nphi);
         
-        /* compute phi and phi' */
-        phi1 = *(cav_w -> phi + (i/(__Ntheta__*__Nphi__))%__Nphi__);
-        phi2 = *(cav_w -> phi + (i%(__Ntheta__*__Nphi__))%__Nphi__);
+        /* compute phi and phi', which the points of a Lebedev grid do not share */
+        phi1 = *(cav_w -> phi + (cav_w -> lebedev ? i/npoints : (i/npoints)%Nphi));
+        phi2 = *(cav_w -> phi + (cav_w -> lebedev ? i%npoints : (i%npoints)%Nphi));
         
         cos_phi1_phi2 = cos(phi1-phi2);
         
@@ -22,30 +22,117 @@ void cavity_initialise_marginal (cavity_workspace *cav_w){
     
     double *p;
     
-    for (p = cav_w -> marginal; p < cav_w -> marginal+__Ntheta__*__Nphi__; p++){
+    for (p = cav_w -> marginal; p < cav_w -> marginal+cav_w -> npoints; p++){
         
         /* initialise with uniform distribution in the unitary sphere */
         *p = 1./M_PI;
     }
     
-    for (p = cav_w -> marginal_dummy; p < cav_w -> marginal_dummy+__Ntheta__*__Nphi__; p++){
+    for (p = cav_w -> marginal_dummy; p < cav_w -> marginal_dummy+cav_w -> npoints; p++){
         
         /* initialise with uniform distribution in the unitary sphere */
         *p = 1./M_PI;
     }
+    
+    /* the iteration starts from the coarser grid, if any */
+    cav_w -> uniform = 1;
 }
 
 /* initialise all tools to be used in the cavity framework */
 void cavity_workspace_initialise (cavity_workspace *cav_w){
     
-    /* assign values and weights to be used in the Gauss-Legendre integration to cos(theta) and phi */
-    abs_and_weights(-1,1, cav_w->cos_theta, cav_w->w_cos_theta,__Ntheta__);
+    if (cav_w -> lebedev){
+        
+        /* assign cos(theta), phi and weight of each point of the Lebedev grid; */
+        /* the weights of the points are carried by w_cos_theta alone */
+        cavity_lebedev_grid (cav_w -> npoints, cav_w->cos_theta, cav_w->phi, cav_w->w_cos_theta);
+        *(cav_w -> w_phi) = 1.;
+    }
+    else
+        /* assign values and weights to be used in the Gauss-Legendre integration to cos(theta) */
+        abs_and_weights(-1,1, cav_w->cos_theta, cav_w->w_cos_theta,cav_w -> Ntheta);
+    
+    if (cav_w -> axisymmetric){
+        
+        /* the marginal does not depend on phi: the integral over phi gives a factor 2 pi */
+        *(cav_w -> phi) = 0.;
+        *(cav_w -> w_phi) = 2*M_PI;
+    }
+    else if (cav_w -> periodic)
+        /* assign values and weights of the trapezoidal rule, spectrally accurate for a periodic function */
+        periodic_abs_and_weights(0,2*M_PI,cav_w->phi,cav_w->w_phi,cav_w -> Nphi);
+    else if (!cav_w -> lebedev)
+        /* assign values and weights to be used in the Gauss-Legendre integration to phi */
+        abs_and_weights(0,2*M_PI,cav_w->phi,cav_w->w_phi,cav_w -> Nphi);
+    
+    /* and the weight of each point of the grid */
+    cavity_compute_weights (cav_w->weight, cav_w->w_cos_theta, cav_w->w_phi, cav_w -> Ntheta, cav_w -> Nphi);
     
-    abs_and_weights(0,2*M_PI,cav_w->phi,cav_w->w_phi,__Nphi__);
+    /* the Legendre polynomials of the spectral products on the points in cos(theta) */
+    if (cav_w -> spectral)
+        cavity_spectral_initialise (cav_w -> spectral, cav_w->cos_theta, cav_w->w_cos_theta);
     
     /* compute the scalar product t*u to be used within the integral in the different cavity routines */
-    cavity_compute_scalar_products (cav_w);
+    /* the axisymmetric kernel is computed from cos(theta) only and does not need them, */
+    /* and the lean kernel only needs their factors sin(theta) and cos(phi-phi'); */
+    /* the transforms of the kernel are computed from cos(theta) only */
+    if (cav_w -> lean)
+        cavity_compute_scalar_factors (cav_w);
+    else if (!cav_w -> axisymmetric && !cav_w -> fft)
+        cavity_compute_scalar_products (cav_w);
+    
+    /* the kernel has to be computed by the first iteration */
+    cav_w -> kernel_ready = 0;
+    
+    /* the points in cos(theta) are not stretched yet */
+    cav_w -> stretch = 0.;
+    
+    /* initialise the coarser grids, and the interpolation of the marginal from the next one */
+    if (cav_w -> coarse){
+        
+        cavity_workspace_initialise (cav_w -> coarse);
+        
+        cavity_multigrid_interpolation (-1, 1, cav_w -> coarse -> cos_theta, cav_w -> coarse -> w_cos_theta, cav_w -> coarse -> Ntheta, cav_w -> cos_theta, cav_w -> Ntheta, cav_w -> prolong_theta);
+        
+        if (cav_w -> axisymmetric)
+            *(cav_w -> prolong_phi) = 1.;
+        else if (cav_w -> periodic)
+            cavity_multigrid_periodic_interpolation (cav_w -> coarse -> Nphi, cav_w -> phi, cav_w -> Nphi, cav_w -> prolong_phi);
+        else
+            cavity_multigrid_interpolation (0, 2*M_PI, cav_w -> coarse -> phi, cav_w -> coarse -> w_phi, cav_w -> coarse -> Nphi, cav_w -> phi, cav_w -> Nphi, cav_w -> prolong_phi);
+    }
     
     /* initialise the cavity marginal */
     cavity_initialise_marginal (cav_w);
 }
+
+/* on an adaptive grid, move the points in cos(theta) to the stretch of the force f, bB */
+/* if it differs from the current one, and recompute all that depends on them */
+void cavity_stretch_grid (cavity_workspace *cav_w, double f, double bB){
+    
+    double stretch;
+    
+    if (!cav_w -> adaptive)
+        return;
+    
+    stretch = stretch_parameter (f, bB);
+    
+    if (stretch == cav_w -> stretch)
+        return;
+    
+    cav_w -> stretch = stretch;
+    
+    stretched_abs_and_weights (stretch, cav_w->cos_theta, cav_w->w_cos_theta, cav_w -> Ntheta);
+    
+    cavity_compute_weights (cav_w->weight, cav_w->w_cos_theta, cav_w->w_phi, cav_w -> Ntheta, cav_w -> Nphi);
+    
+    if (cav_w -> lean)
+        cavity_compute_scalar_factors (cav_w);
+    else if (!cav_w -> axisymmetric && !cav_w -> fft)
+        cavity_compute_scalar_products (cav_w);
+    
+    cav_w -> kernel_ready = 0;
+    
+    /* the marginal on the previous points is no starting point on the new ones */
+    cavity_initialise_marginal (cav_w);
+}
@@ -20,11 +20,13 @@
 
 #include <math.h>
 #include "cavity_integrate.h"
+#include "cavity_kernel.h"
 #include "cavity_macros.h"
 #include "cavity.h"
 #include "cavity_scalar.h"
 
 void cavity_initialise_marginal (cavity_workspace *);
 void cavity_workspace_initialise (cavity_workspace *);
+void cavity_stretch_grid (cavity_workspace *, double, double);
 
 #endif
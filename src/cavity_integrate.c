@@ -72,3 +72,55 @@ void abs_and_weights(double x_low, double x_high, double *x, double *w, int Npts
         i++;
     }
 }
+
+/* compute the abscissae and weights of the Gauss-Legendre quadrature in [-1, 1] mapped by */
+/* x = 1 - 2 (exp(c (1-s)/2) - 1)/(exp(c) - 1), which clusters the points near x = 1 for c > 0 */
+/* (near x = -1 for c < 0, by symmetry) with a spacing smaller by ~|c|/(exp(|c|) - 1) */
+void stretched_abs_and_weights(double c, double *x, double *w, int Npts){
+    
+    int i;
+    double a = fabs(c), E, e;
+    
+    abs_and_weights(-1,1,x,w,Npts);
+    
+    /* the mapping is the identity for c = 0 */
+    if (a == 0.)
+        return;
+    
+    E = exp(a)-1.;
+    
+    for (i=0; i<Npts; i++){
+        
+        e = exp(0.5*a*(1.-(c > 0. ? 1. : -1.) * *(x + i)));
+        
+        *(x + i) = (c > 0. ? 1. : -1.) * (1.-2.*(e-1.)/E);
+        *(w + i) *= a*e/E;
+    }
+}
+
+/* parameter of the stretched grid in cos(theta) for the force f: the field factor exp(bB f cos(theta)) */
+/* concentrates the marginal around cos(theta) = sign(f) over a width ~1/a, with a = 2 |f bB|, which */
+/* the stretch log(1+a) resolves with a number of points independent of a; it is rounded to */
+/* a multiple of __STRETCH_STEP__, so that nearby forces share the same grid and kernel */
+/* (the narrowing of the marginal by JB at high force is left out: at low force, it would */
+/* stretch the grid where the kernel exp(JB t*u) needs the points spread over the sphere) */
+double stretch_parameter(double f, double bB){
+    
+    double a = 2.*fabs(f*bB);
+    double c = __STRETCH_STEP__*floor(log1p(a)/__STRETCH_STEP__ + 0.5);
+    
+    return f < 0. ? -c : c;
+}
+
+/* compute the abscissae and weights of the trapezoidal rule for a periodic function */
+/* of period x_high - x_low, on Npoints evenly spaced points starting at x_low */
+void periodic_abs_and_weights(double x_low, double x_high, double *x, double *w, int Npts){
+    
+    int i;
+    
+    for (i=0; i<Npts; i++){
+        
+        *(x + i) = x_low + i*(x_high-x_low)/Npts;
+        *(w + i) = (x_high-x_low)/Npts;
+    }
+}
@@ -23,4 +23,10 @@
 
 void abs_and_weights(double, double, double *, double *, int);
 
+void periodic_abs_and_weights(double, double, double *, double *, int);
+
+void stretched_abs_and_weights(double, double *, double *, int);
+
+double stretch_parameter(double, double);
+
 #endif
@@ -0,0 +1,332 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <gsl/gsl_cblas.h>
+#include "cavity_kernel.h"
+#include "cavity_simd.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* compute the quadrature weight w(theta) * w(phi) of every point of the Ntheta x Nphi grid */
+void cavity_compute_weights (double *weight, const double *w_cos_theta, const double *w_phi, int Ntheta, int Nphi) {
+    
+    double *w;
+    int i=0;
+    
+    for (w = weight; w < weight+Ntheta*Nphi; w++){
+        
+        /* i/Nphi gives the (index of) angle theta and i%Nphi the one of phi */
+        *w = *(w_cos_theta + i/Nphi) * *(w_phi + i%Nphi);
+        
+        i++;
+    }
+}
+
+/* compute the Boltzmann kernel K(t,u) = w(u) * exp(J * t*u) for all values of t and u */
+/* so that the integral in Eq. (9) of Massucci et al. 2014 becomes the matrix-vector product K * P_c */
+/* all the kernels are scaled by exp(-|J|), which bounds them by the weights for any J */
+/* (see cavity_simd_kernel_row); the scale cancels in the normalised marginal and its derivatives */
+/* the rows of the kernel are independent, and are shared among the OpenMP threads on large grids */
+void cavity_compute_kernel (double *kernel, const double *scalar_prod, const double *weight, double JB, int npoints) {
+    
+    int i;
+    
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (npoints >= __OMP_MIN_POINTS__)
+#endif
+    for (i=0; i<npoints; i++)
+        cavity_simd_kernel_row (kernel + (size_t) i*npoints, scalar_prod + (size_t) i*npoints, weight, JB, npoints);
+}
+
+/* compute the Boltzmann kernel in single precision: each row is computed in double precision */
+/* by chunks of __KERNEL_CHUNK__ points, which are then rounded to single precision */
+void cavity_compute_kernel_single (float *kernel, const double *scalar_prod, const double *weight, double JB, int npoints) {
+    
+    int i, j, k, len;
+    double K[__KERNEL_CHUNK__];
+    
+#ifdef _OPENMP
+#pragma omp parallel for private(j, k, len, K) schedule(static) if (npoints >= __OMP_MIN_POINTS__)
+#endif
+    for (i=0; i<npoints; i++)
+        for (j=0; j<npoints; j+=__KERNEL_CHUNK__){
+            
+            len = npoints-j < __KERNEL_CHUNK__ ? npoints-j : __KERNEL_CHUNK__;
+            
+            cavity_simd_kernel_row (K, scalar_prod + (size_t) i*npoints + j, weight + j, JB, len);
+            
+            for (k=0; k<len; k++)
+                *(kernel + (size_t) i*npoints + j + k) = (float) K[k];
+        }
+}
+
+/* compute the derivative of the Boltzmann kernel wrt JB, i.e. w(u) * t*u * exp(J * t*u) */
+/* this is the kernel of the first integral in Eq. (15) of Massucci et al. 2014 */
+void cavity_compute_kernel_JB (double *kernel_JB, const double *scalar_prod, const double *kernel, int npoints) {
+    
+    size_t i, n = (size_t) npoints*npoints;
+    
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (npoints >= __OMP_MIN_POINTS__)
+#endif
+    for (i=0; i<n; i++)
+        *(kernel_JB + i) = *(scalar_prod + i) * *(kernel + i);
+}
+
+/* compute the Boltzmann kernel of an axisymmetric marginal, which only depends on theta */
+/* the integral of exp(J * t*u) over phi' is 2 pi * exp(J cos(theta)cos(theta')) * I0(J sin(theta)sin(theta')), */
+/* with I0 the modified Bessel function; the factor 2 pi is stored in the phi weight, which is part of the point weight */
+void cavity_compute_kernel_axisymmetric (double *kernel, const double *cos_theta, const double *weight, double JB, int Ntheta) {
+    
+    double *K, x, sin_theta1, sin_theta2;
+    int i, j;
+    
+#ifdef _OPENMP
+#pragma omp parallel for private(j, K, x, sin_theta1, sin_theta2) schedule(static) if (Ntheta >= __OMP_MIN_POINTS__)
+#endif
+    for (i=0; i<Ntheta; i++){
+        
+        /* i gives the (index of) theta and j the one of theta' */
+        K = kernel + (size_t) i*Ntheta;
+        
+        sin_theta1 = sqrt(1.-*(cos_theta + i) * *(cos_theta + i));
+        
+        for (j=0; j<Ntheta; j++){
+            
+            sin_theta2 = sqrt(1.-*(cos_theta + j) * *(cos_theta + j));
+            
+            x = JB*sin_theta1*sin_theta2;
+            
+            /* use the scaled Bessel function I0(x) exp(-|x|) so that the exponentials can be combined without overflow */
+            /* since cc' + |ss'| <= 1, the exponent of the kernel scaled by exp(-|J|) is at most 0 */
+            *(K + j) = *(weight + j) * exp(JB * *(cos_theta + i) * *(cos_theta + j) + fabs(x) - fabs(JB)) * gsl_sf_bessel_I0_scaled(x);
+        }
+    }
+}
+
+/* compute the derivative wrt JB of the axisymmetric Boltzmann kernel */
+/* d/dJ [exp(J c c') I0(J s s')] = exp(J c c') [c c' I0(J s s') + s s' I1(J s s')], scaled by exp(-|J|) as the kernel */
+void cavity_compute_kernel_JB_axisymmetric (double *kernel_JB, const double *cos_theta, const double *weight, double JB, int Ntheta) {
+    
+    double *K, x, sin_theta1, sin_theta2, cc;
+    int i, j;
+    
+#ifdef _OPENMP
+#pragma omp parallel for private(j, K, x, sin_theta1, sin_theta2, cc) schedule(static) if (Ntheta >= __OMP_MIN_POINTS__)
+#endif
+    for (i=0; i<Ntheta; i++){
+        
+        K = kernel_JB + (size_t) i*Ntheta;
+        
+        sin_theta1 = sqrt(1.-*(cos_theta + i) * *(cos_theta + i));
+        
+        for (j=0; j<Ntheta; j++){
+            
+            sin_theta2 = sqrt(1.-*(cos_theta + j) * *(cos_theta + j));
+            
+            cc = *(cos_theta + i) * *(cos_theta + j);
+            x = JB*sin_theta1*sin_theta2;
+            
+            *(K + j) = *(weight + j) * exp(JB*cc + fabs(x) - fabs(JB)) * (cc*gsl_sf_bessel_I0_scaled(x) + sin_theta1*sin_theta2*gsl_sf_bessel_I1_scaled(x));
+        }
+    }
+}
+
+/* compute the external field factor exp(b_B * f * z*t) on every point of the Ntheta x Nphi grid, */
+/* scaled by exp(-|b_B * f| z_max), with z_max the largest |z*t| of the grid, so that it is at most 1 */
+/* and cannot overflow whatever the force; return the logarithm |b_B * f| z_max of the scale */
+double cavity_compute_field (double *field, const double *cos_theta, double f, double bB, int Ntheta, int Nphi) {
+    
+    double *h, z_max=0., shift;
+    int i=0;
+    
+    for (i=0; i<Ntheta; i++)
+        if (fabs(*(cos_theta + i)) > z_max)
+            z_max = fabs(*(cos_theta + i));
+    
+    shift = fabs(f*bB)*z_max;
+    
+    i = 0;
+    
+    for (h = field; h < field+Ntheta*Nphi; h++){
+        
+        *h = exp(f* *(cos_theta+ i/Nphi)*bB - shift);
+        
+        i++;
+    }
+    
+    return shift;
+}
+
+/* compute out = K * p + beta * out for a kernel K on npoints points */
+/* on large grids, the rows are split in contiguous blocks, one per OpenMP thread. Every row is computed */
+/* by a single thread, in the same way as in the serial product, so that the result does not depend on */
+/* the number of threads */
+void cavity_kernel_product (const double *kernel, const double *p, double beta, double *out, int npoints) {
+    
+#ifdef _OPENMP
+#pragma omp parallel if (npoints >= __OMP_MIN_POINTS__)
+    {
+        int nthreads = omp_get_num_threads(), thread = omp_get_thread_num();
+        int start = (int) ((long) npoints*thread/nthreads), end = (int) ((long) npoints*(thread+1)/nthreads);
+        
+        if (end > start)
+            cblas_dgemv (CblasRowMajor, CblasNoTrans, end-start, npoints, 1., kernel + (size_t) start*npoints, npoints, p, 1, beta, out+start, 1);
+    }
+#else
+    cblas_dgemv (CblasRowMajor, CblasNoTrans, npoints, npoints, 1., kernel, npoints, p, 1, beta, out, 1);
+#endif
+}
+
+/* compute out = K * p for a kernel K on npoints points, in single precision */
+/* the rows are split among the OpenMP threads as in cavity_kernel_product */
+void cavity_kernel_product_single (const float *kernel, const float *p, float *out, int npoints) {
+    
+#ifdef _OPENMP
+#pragma omp parallel if (npoints >= __OMP_MIN_POINTS__)
+    {
+        int nthreads = omp_get_num_threads(), thread = omp_get_thread_num();
+        int start = (int) ((long) npoints*thread/nthreads), end = (int) ((long) npoints*(thread+1)/nthreads);
+        
+        if (end > start)
+            cblas_sgemv (CblasRowMajor, CblasNoTrans, end-start, npoints, 1.f, kernel + (size_t) start*npoints, npoints, p, 1, 0.f, out+start, 1);
+    }
+#else
+    cblas_sgemv (CblasRowMajor, CblasNoTrans, npoints, npoints, 1.f, kernel, npoints, p, 1, 0.f, out, 1);
+#endif
+}
+
+/* compute the Nphi x Nphi tile E(phi, phi') = exp(J * t*u - |J|) of the kernel between theta = a and theta' = b, without the weights */
+static void cavity_kernel_tile (double *E, double *s, const double *ones, const double *cos_theta, const double *sin_theta, const double *cos_dphi, double JB, int a, int b, int Nphi) {
+    
+    int i, j;
+    double cc = *(cos_theta + a) * *(cos_theta + b), ss = *(sin_theta + a) * *(sin_theta + b);
+    
+    for (i=0; i<Nphi; i++){
+        
+        for (j=0; j<Nphi; j++)
+            *(s + j) = cc + ss * *(cos_dphi + i*Nphi + j);
+        
+        cavity_simd_kernel_row (E + (size_t) i*Nphi, s, ones, JB, Nphi);
+    }
+}
+
+/* allocate the buffers of the lean product on the Ntheta x Nphi grid, with a tile for each OpenMP thread */
+/* the rows a of the blocks of tiles (a, b >= a) are chosen so that the blocks have about as many tiles */
+cavity_lean *cavity_lean_alloc (int Ntheta, int Nphi){
+    
+    cavity_lean *lean = (cavity_lean *) malloc (sizeof(cavity_lean));
+    long tiles = 0, total = (long) Ntheta*(Ntheta+1)/2;
+    int i, a;
+    
+#ifdef _OPENMP
+    lean -> nthreads = omp_get_max_threads();
+#else
+    lean -> nthreads = 1;
+#endif
+    
+    lean -> nblocks = Ntheta < __LEAN_BLOCKS__ ? Ntheta : __LEAN_BLOCKS__;
+    lean -> block = (int *) malloc ((lean -> nblocks+1)*sizeof(int));
+    
+    for (i=0, a=0; i<lean -> nblocks; i++){
+        
+        *(lean -> block + i) = a;
+        
+        while (a < Ntheta && (i == lean -> nblocks-1 || tiles < total*(i+1)/lean -> nblocks))
+            tiles += Ntheta - a++;
+    }
+    
+    *(lean -> block + lean -> nblocks) = Ntheta;
+    
+    lean -> q = (double *) malloc ((size_t) Ntheta*Nphi*sizeof(double));
+    lean -> E = (double *) malloc ((size_t) lean -> nthreads*Nphi*Nphi*sizeof(double));
+    lean -> s = (double *) malloc ((size_t) lean -> nthreads*Nphi*sizeof(double));
+    lean -> ones = (double *) malloc (Nphi*sizeof(double));
+    
+    /* the first block sums into the output of the product */
+    lean -> out = lean -> nblocks > 1 ? (double *) malloc ((size_t) (lean -> nblocks-1)*Ntheta*Nphi*sizeof(double)) : NULL;
+    
+    for (i=0; i<Nphi; i++)
+        *(lean -> ones + i) = 1.;
+    
+    return lean;
+}
+
+/* free the buffers of the lean product */
+void cavity_lean_free (cavity_lean *lean){
+    
+    free (lean -> block);
+    free (lean -> q);
+    free (lean -> E);
+    free (lean -> s);
+    free (lean -> ones);
+    free (lean -> out);
+    
+    free (lean);
+}
+
+/* compute out = K * p for the kernel K(t,u) = w(u) * exp(J * t*u) on the Ntheta x Nphi grid, */
+/* without storing it: the kernel is computed by Nphi x Nphi tiles, one per pair of values of theta, */
+/* which stay in cache while they are used. With q = w * p, the tile E between theta = a and b */
+/* contributes E q_b to out_a, and since t*u is symmetric, E^T q_a to out_b: each tile is computed */
+/* once, for a <= b. The tiles are grouped by blocks of values of a, each summing into its own copy */
+/* of out, and the copies are added in the order of the blocks: on large grids, the blocks are shared */
+/* among the OpenMP threads, and the result does not depend on the number of threads */
+void cavity_kernel_product_lean (cavity_lean *lean, const double *cos_theta, const double *sin_theta, const double *cos_dphi, const double *weight, double JB, const double *p, double *out, int Ntheta, int Nphi) {
+    
+    int i, k, npoints = Ntheta*Nphi;
+    
+    for (i=0; i<npoints; i++)
+        *(lean -> q + i) = *(weight + i) * *(p + i);
+    
+#ifdef _OPENMP
+#pragma omp parallel for private(i) schedule(dynamic) num_threads(lean -> nthreads) if (npoints >= __OMP_MIN_POINTS__)
+#endif
+    for (k=0; k<lean -> nblocks; k++){
+        
+        int a, b, thread = 0;
+        double *E, *s, *o = k ? lean -> out + (size_t) (k-1)*npoints : out;
+        
+#ifdef _OPENMP
+        thread = omp_get_thread_num();
+#endif
+        
+        E = lean -> E + (size_t) thread*Nphi*Nphi;
+        s = lean -> s + (size_t) thread*Nphi;
+        
+        for (i=0; i<npoints; i++)
+            *(o + i) = 0.;
+        
+        for (a=*(lean -> block + k); a<*(lean -> block + k+1); a++)
+            for (b=a; b<Ntheta; b++){
+                
+                cavity_kernel_tile (E, s, lean -> ones, cos_theta, sin_theta, cos_dphi, JB, a, b, Nphi);
+                
+                cblas_dgemv (CblasRowMajor, CblasNoTrans, Nphi, Nphi, 1., E, Nphi, lean -> q + b*Nphi, 1, 1., o + a*Nphi, 1);
+                
+                if (b != a)
+                    cblas_dgemv (CblasRowMajor, CblasTrans, Nphi, Nphi, 1., E, Nphi, lean -> q + a*Nphi, 1, 1., o + b*Nphi, 1);
+            }
+    }
+    
+    /* add the copies of the other blocks */
+    for (k=1; k<lean -> nblocks; k++)
+        cblas_daxpy (npoints, 1., lean -> out + (size_t) (k-1)*npoints, 1, out, 1);
+}
@@ -0,0 +1,65 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CAVITY_KERNEL_H__
+#define __CAVITY_KERNEL_H__
+
+#include <math.h>
+#include <gsl/gsl_sf_bessel.h>
+#include "cavity_macros.h"
+
+void cavity_compute_weights (double *, const double *, const double *, int, int);
+
+void cavity_compute_kernel (double *, const double *, const double *, double, int);
+
+void cavity_compute_kernel_single (float *, const double *, const double *, double, int);
+
+void cavity_compute_kernel_JB (double *, const double *, const double *, int);
+
+void cavity_compute_kernel_axisymmetric (double *, const double *, const double *, double, int);
+
+void cavity_compute_kernel_JB_axisymmetric (double *, const double *, const double *, double, int);
+
+double cavity_compute_field (double *, const double *, double, double, int, int);
+
+void cavity_kernel_product (const double *, const double *, double, double *, int);
+
+void cavity_kernel_product_single (const float *, const float *, float *, int);
+
+/* buffers of the lean product, allocated once for a grid: q = w * p, for each of the nthreads OpenMP threads */
+/* an Nphi x Nphi tile E of the kernel with its scalar products s, and the boundaries in theta of the nblocks */
+/* blocks of tiles, with a copy of the output for each block beyond the first, which sums into the output */
+typedef struct{
+    
+    int nthreads;
+    int nblocks;
+    int *block;
+    double *q;
+    double *E;
+    double *s;
+    double *ones;
+    double *out;
+    
+} cavity_lean;
+
+cavity_lean *cavity_lean_alloc (int, int);
+
+void cavity_lean_free (cavity_lean *);
+
+void cavity_kernel_product_lean (cavity_lean *, const double *, const double *, const double *, const double *, double, const double *, double *, int, int);
+
+#endif
@@ -0,0 +1,240 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include <math.h>
+#include <gsl/gsl_errno.h>
+#include "cavity_lebedev.h"
+
+/******************************************************************
+ *                                                                *
+ *  Lebedev quadratures on the unit sphere, exact for the         *
+ *  spherical harmonics up to the given degree. The parameters    *
+ *  and weights (normalised to a sum of 1) of the orbits are      *
+ *  those published by V. I. Lebedev & D. N. Laikov,              *
+ *  Doklady Mathematics 59, 477 (1999).                           *
+ *                                                                *
+ *****************************************************************/
+
+/* 6 points, exact up to degree 3 */
+static const cavity_lebedev_orbit cavity_lebedev_6[] = {
+    {LEBEDEV_A1, 0, 0, 0.1666666666666667}
+};
+
+/* 14 points, exact up to degree 5 */
+static const cavity_lebedev_orbit cavity_lebedev_14[] = {
+    {LEBEDEV_A1, 0, 0, 0.06666666666666667},
+    {LEBEDEV_A3, 0, 0, 0.07500000000000000}
+};
+
+/* 26 points, exact up to degree 7 */
+static const cavity_lebedev_orbit cavity_lebedev_26[] = {
+    {LEBEDEV_A1, 0, 0, 0.04761904761904762},
+    {LEBEDEV_A2, 0, 0, 0.03809523809523810},
+    {LEBEDEV_A3, 0, 0, 0.03214285714285714}
+};
+
+/* 38 points, exact up to degree 9 */
+static const cavity_lebedev_orbit cavity_lebedev_38[] = {
+    {LEBEDEV_A1, 0, 0, 0.009523809523809524},
+    {LEBEDEV_A3, 0, 0, 0.03214285714285714},
+    {LEBEDEV_C, 0.4597008433809831, 0, 0.02857142857142857}
+};
+
+/* 50 points, exact up to degree 11 */
+static const cavity_lebedev_orbit cavity_lebedev_50[] = {
+    {LEBEDEV_A1, 0, 0, 0.01269841269841270},
+    {LEBEDEV_A2, 0, 0, 0.02257495590828924},
+    {LEBEDEV_A3, 0, 0, 0.02109375000000000},
+    {LEBEDEV_B, 0.3015113445777636, 0, 0.02017333553791887}
+};
+
+/* 86 points, exact up to degree 15 */
+static const cavity_lebedev_orbit cavity_lebedev_86[] = {
+    {LEBEDEV_A1, 0, 0, 0.01154401154401154},
+    {LEBEDEV_A3, 0, 0, 0.01194390908585628},
+    {LEBEDEV_B, 0.6943540066026664, 0, 0.01187650129453714},
+    {LEBEDEV_B, 0.3696028464541502, 0, 0.01111055571060340},
+    {LEBEDEV_C, 0.3742430390903412, 0, 0.01181230374690448}
+};
+
+/* 110 points, exact up to degree 17 */
+static const cavity_lebedev_orbit cavity_lebedev_110[] = {
+    {LEBEDEV_A1, 0, 0, 0.003828270494937162},
+    {LEBEDEV_A3, 0, 0, 0.009793737512487512},
+    {LEBEDEV_B, 0.6904210483822922, 0, 0.009942814891178103},
+    {LEBEDEV_B, 0.1851156353447362, 0, 0.008211737283191111},
+    {LEBEDEV_B, 0.3956894730559419, 0, 0.009595471336070963},
+    {LEBEDEV_C, 0.4783690288121502, 0, 0.009694996361663028}
+};
+
+/* 146 points, exact up to degree 19 */
+static const cavity_lebedev_orbit cavity_lebedev_146[] = {
+    {LEBEDEV_A1, 0, 0, 0.0005996313688621381},
+    {LEBEDEV_A2, 0, 0, 0.007372999718620756},
+    {LEBEDEV_A3, 0, 0, 0.007210515360144488},
+    {LEBEDEV_B, 0.6764410400114264, 0, 0.007116355493117555},
+    {LEBEDEV_B, 0.4174961227965453, 0, 0.006753829486314477},
+    {LEBEDEV_B, 0.1574676672039082, 0, 0.007574394159054034},
+    {LEBEDEV_D, 0.1403553811713183, 0.4493328323269557, 0.006991087353303262}
+};
+
+/* 170 points, exact up to degree 21 */
+static const cavity_lebedev_orbit cavity_lebedev_170[] = {
+    {LEBEDEV_A1, 0, 0, 0.005544842902037365},
+    {LEBEDEV_A2, 0, 0, 0.006071332770670752},
+    {LEBEDEV_A3, 0, 0, 0.006383674773515093},
+    {LEBEDEV_B, 0.2551252621114134, 0, 0.005183387587747790},
+    {LEBEDEV_B, 0.6743601460362766, 0, 0.006317929009813725},
+    {LEBEDEV_B, 0.4318910696719410, 0, 0.006201670006589077},
+    {LEBEDEV_C, 0.2613931360335988, 0, 0.005477143385137348},
+    {LEBEDEV_D, 0.4990453161796037, 0.1446630744325115, 0.005968383987681156}
+};
+
+/* 194 points, exact up to degree 23 */
+static const cavity_lebedev_orbit cavity_lebedev_194[] = {
+    {LEBEDEV_A1, 0, 0, 0.001782340447244611},
+    {LEBEDEV_A2, 0, 0, 0.005716905949977102},
+    {LEBEDEV_A3, 0, 0, 0.005573383178848738},
+    {LEBEDEV_B, 0.6712973442695226, 0, 0.005608704082587997},
+    {LEBEDEV_B, 0.2892465627575439, 0, 0.005158237711805383},
+    {LEBEDEV_B, 0.4446933178717437, 0, 0.005518771467273614},
+    {LEBEDEV_B, 0.1299335447650067, 0, 0.004106777028169394},
+    {LEBEDEV_C, 0.3457702197611283, 0, 0.005051846064614808},
+    {LEBEDEV_D, 0.1590417105383530, 0.8360360154824589, 0.005530248916233094}
+};
+
+typedef struct {
+    int npoints;
+    int degree;
+    int norbits;
+    const cavity_lebedev_orbit *orbits;
+} cavity_lebedev_rule;
+
+#define __LEBEDEV_RULE__(n, d) {n, d, sizeof(cavity_lebedev_##n)/sizeof(cavity_lebedev_orbit), cavity_lebedev_##n}
+
+static const cavity_lebedev_rule cavity_lebedev_rules[] = {
+    __LEBEDEV_RULE__(6, 3),
+    __LEBEDEV_RULE__(14, 5),
+    __LEBEDEV_RULE__(26, 7),
+    __LEBEDEV_RULE__(38, 9),
+    __LEBEDEV_RULE__(50, 11),
+    __LEBEDEV_RULE__(86, 15),
+    __LEBEDEV_RULE__(110, 17),
+    __LEBEDEV_RULE__(146, 19),
+    __LEBEDEV_RULE__(170, 21),
+    __LEBEDEV_RULE__(194, 23)
+};
+
+/* find the rule with npoints points, NULL if there is none */
+static const cavity_lebedev_rule *cavity_lebedev_find (int npoints){
+    
+    size_t i;
+    
+    for (i=0; i<sizeof(cavity_lebedev_rules)/sizeof(cavity_lebedev_rule); i++)
+        if (cavity_lebedev_rules[i].npoints == npoints)
+            return cavity_lebedev_rules + i;
+    
+    return NULL;
+}
+
+/* degree up to which the rule with npoints points is exact, -1 if there is no such rule */
+int cavity_lebedev_degree (int npoints){
+    
+    const cavity_lebedev_rule *rule = cavity_lebedev_find (npoints);
+    
+    return rule ? rule -> degree : -1;
+}
+
+/* append to v the distinct points obtained by permuting the coordinates of v[0..2] */
+/* and changing their signs, and return their number */
+static int cavity_lebedev_expand (double *v){
+    
+    static const int perm[6][3] = {{0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0}};
+    double u[3], base[3] = {v[0], v[1], v[2]};
+    int p, s, k, m, n = 0, duplicate;
+    
+    for (p=0; p<6; p++)
+        for (s=0; s<8; s++){
+            
+            for (k=0; k<3; k++)
+                u[k] = (s >> k & 1 ? -1. : 1.) * base[perm[p][k]];
+            
+            duplicate = 0;
+            
+            for (m=0; m<n && !duplicate; m++)
+                duplicate = u[0] == v[3*m] && u[1] == v[3*m+1] && u[2] == v[3*m+2];
+            
+            if (!duplicate){
+                
+                for (k=0; k<3; k++)
+                    v[3*n+k] = u[k];
+                
+                n++;
+            }
+        }
+    
+    return n;
+}
+
+/* fill cos(theta), phi and the weight (summing to 4 pi) of the points of the Lebedev grid with npoints points */
+int cavity_lebedev_grid (int npoints, double *cos_theta, double *phi, double *weight){
+    
+    const cavity_lebedev_rule *rule = cavity_lebedev_find (npoints);
+    double v[3*48];
+    int o, i, n, k = 0;
+    
+    if (!rule)
+        return GSL_EINVAL;
+    
+    for (o=0; o<rule -> norbits; o++){
+        
+        const cavity_lebedev_orbit *orbit = rule -> orbits + o;
+        
+        switch (orbit -> generator){
+            
+            case LEBEDEV_A1:
+                v[0] = 1.; v[1] = 0.; v[2] = 0.;
+                break;
+            case LEBEDEV_A2:
+                v[0] = 0.; v[1] = sqrt(0.5); v[2] = sqrt(0.5);
+                break;
+            case LEBEDEV_A3:
+                v[0] = v[1] = v[2] = sqrt(1./3.);
+                break;
+            case LEBEDEV_B:
+                v[0] = v[1] = orbit -> a; v[2] = sqrt(1.-2*orbit -> a*orbit -> a);
+                break;
+            case LEBEDEV_C:
+                v[0] = orbit -> a; v[1] = sqrt(1.-orbit -> a*orbit -> a); v[2] = 0.;
+                break;
+            case LEBEDEV_D:
+                v[0] = orbit -> a; v[1] = orbit -> b; v[2] = sqrt(1.-orbit -> a*orbit -> a-orbit -> b*orbit -> b);
+                break;
+        }
+        
+        n = cavity_lebedev_expand (v);
+        
+        for (i=0; i<n && k<npoints; i++, k++){
+            
+            *(cos_theta + k) = v[3*i+2];
+            *(phi + k) = atan2(v[3*i+1], v[3*i]);
+            *(weight + k) = 4*M_PI*orbit -> weight;
+        }
+    }
+    
+    return k == npoints ? GSL_SUCCESS : GSL_EFAILED;
+}
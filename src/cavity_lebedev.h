@@ -0,0 +1,37 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __CAVITY_LEBEDEV_H__
+#define __CAVITY_LEBEDEV_H__
+
+/* a Lebedev grid is a list of points on the unit sphere invariant under the octahedral group, */
+/* made of orbits of the generators (V.I. Lebedev, D.N. Laikov, Doklady Mathematics 59 (1999) 477): */
+/* a1 = (1,0,0), a2 = (0,1,1)/sqrt(2), a3 = (1,1,1)/sqrt(3), b = (l,l,m), c = (p,q,0) and d = (r,s,t), */
+/* with the other coordinates fixed by the normalisation; the points of an orbit share one weight */
+typedef enum { LEBEDEV_A1, LEBEDEV_A2, LEBEDEV_A3, LEBEDEV_B, LEBEDEV_C, LEBEDEV_D } cavity_lebedev_generator;
+
+typedef struct {
+    cavity_lebedev_generator generator;
+    double a;
+    double b;
+    double weight;
+} cavity_lebedev_orbit;
+
+int cavity_lebedev_degree (int);
+
+int cavity_lebedev_grid (int, double *, double *, double *);
+
+#endif
@@ -17,6 +17,7 @@
 
 #define EPS 1.e-5
 
+/* default size of the grid, see wlc_cavity_params */
 #ifndef __Ntheta__
 
 #define __Ntheta__ 15
@@ -31,6 +32,7 @@
 #endif
 
 
+/* default values of the cavity solver parameters, see wlc_cavity_params */
 #ifndef __TOL__
 
 #define __TOL__ 1.e-5
@@ -38,10 +40,110 @@
 #endif
 
 
-#define __ALLOC_COS_THETA__ (double *) malloc(__Ntheta__*sizeof(double))
+#ifndef __MAX_ITER__
 
-#define __ALLOC_PHI__ (double *) malloc(__Nphi__*sizeof(double))
+#define __MAX_ITER__ 100000
 
-#define __ALLOC_MARGINAL__ (double *) malloc(__Ntheta__*__Nphi__*sizeof(double))
+#endif
+
+
+/* the stretch of the force-adaptive grid in cos(theta) is rounded to multiples of __STRETCH_STEP__ */
+#ifndef __STRETCH_STEP__
+
+#define __STRETCH_STEP__ 0.5
+
+#endif
+
+
+/* the coarse grids of the multigrid iteration keep at least __MULTIGRID_MIN__ points in cos(theta) and phi */
+#ifndef __MULTIGRID_MIN__
+
+#define __MULTIGRID_MIN__ 4
+
+#endif
+
+
+/* the rate of convergence used to estimate the error of the observables is at most __RATE_MAX__ */
+#ifndef __RATE_MAX__
+
+#define __RATE_MAX__ 0.99
+
+#endif
+
+
+/* the sizes of the arrays are read from the grid stored in the workspace w */
+#define __ALLOC_COS_THETA__(w) (double *) malloc((w)->Ntheta*sizeof(double))
+
+#define __ALLOC_PHI__(w) (double *) malloc((w)->Nphi*sizeof(double))
+
+#define __ALLOC_MARGINAL__(w) (double *) malloc((w)->npoints*sizeof(double))
+
+#define __ALLOC_SCALAR_PRODUCT__(w) (double *) malloc((size_t) (w)->npoints*(w)->npoints*sizeof(double))
+
+#define __ALLOC_KERNEL__(w) (double *) malloc((size_t) (w)->npoints*(w)->npoints*sizeof(double))
+
+#define __ALLOC_KERNEL_SINGLE__(w) (float *) malloc((size_t) (w)->npoints*(w)->npoints*sizeof(float))
+
+#define __ALLOC_MARGINAL_SINGLE__(w) (float *) malloc((w)->npoints*sizeof(float))
+
+#define __ALLOC_COS_DPHI__(w) (double *) malloc((size_t) (w)->Nphi*(w)->Nphi*sizeof(double))
+
+
+/* grids with up to __EIGEN_DENSE__ points are diagonalised densely by the eigen-solver, */
+/* larger ones with a Lanczos iteration restarted every __EIGEN_KRYLOV__ steps */
+#ifndef __EIGEN_DENSE__
+
+#define __EIGEN_DENSE__ 100
+
+#endif
 
-#define __ALLOC_SCALAR_PRODUCT__ (double *) malloc(__Ntheta__*__Nphi__*__Ntheta__*__Nphi__*sizeof(double))
+
+#ifndef __EIGEN_KRYLOV__
+
+#define __EIGEN_KRYLOV__ 40
+
+#endif
+
+
+/* the tangent system of the implicit gradient is solved by GMRES restarted every __GMRES_KRYLOV__ steps */
+#ifndef __GMRES_KRYLOV__
+
+#define __GMRES_KRYLOV__ 30
+
+#endif
+
+
+/* when compiled with OpenMP, the products with the kernel and its construction are shared */
+/* among the threads on grids with at least __OMP_MIN_POINTS__ points */
+#ifndef __OMP_MIN_POINTS__
+
+#define __OMP_MIN_POINTS__ 400
+
+#endif
+
+
+/* number of blocks of rows in theta among which the tiles of the lean product are shared, */
+/* each summing into its own copy of the output */
+#ifndef __LEAN_BLOCKS__
+
+#define __LEAN_BLOCKS__ 16
+
+#endif
+
+
+/* number of points of a row of the kernel computed at once in double precision */
+/* before being rounded to the single precision kernel */
+#ifndef __KERNEL_CHUNK__
+
+#define __KERNEL_CHUNK__ 256
+
+#endif
+
+
+/* scale x0 of f*bB below which the nodes of a table are evenly spaced, */
+/* and beyond which they are logarithmically spaced, as x = x0 sinh(u) with u evenly spaced */
+#ifndef __TABLE_SCALE__
+
+#define __TABLE_SCALE__ 0.1
+
+#endif
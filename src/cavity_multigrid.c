@@ -0,0 +1,126 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include <math.h>
+#include <gsl/gsl_cblas.h>
+#include "cavity_multigrid.h"
+
+/******************************************************************
+ *                                                                *
+ *  Coarse-to-fine solution of the cavity equations: the         *
+ *  marginal converged on a grid with half the points in          *
+ *  cos(theta) and phi, where the kernel is 16 times smaller, is  *
+ *  interpolated to the finer grid as the starting point of its   *
+ *  iteration.                                                    *
+ *                                                                *
+ *  The interpolation is the barycentric Lagrange formula         *
+ *  p(y) = sum_k b_k/(y-x_k) p_k / sum_k b_k/(y-x_k), which is    *
+ *  stable on the Gauss-Legendre points x_k with the weights      *
+ *  b_k = (-1)^k sqrt((1-x_k^2) w_k), and its trigonometric       *
+ *  counterpart on a periodic grid in phi.                        *
+ *                                                                *
+ *****************************************************************/
+
+/* fill the row of T of the point y from the barycentric terms c_k = b_k/(y-x_k), */
+/* or with the corresponding unit row if y is one of the points */
+static void cavity_multigrid_row (double *T, const double *c, int exact, int n){
+    
+    int k;
+    double sum = 0.;
+    
+    if (exact >= 0){
+        
+        for (k=0; k<n; k++)
+            *(T + k) = k == exact ? 1. : 0.;
+        
+        return;
+    }
+    
+    for (k=0; k<n; k++)
+        sum += *(c + k);
+    
+    for (k=0; k<n; k++)
+        *(T + k) = *(c + k)/sum;
+}
+
+/* compute the m x n matrix T that interpolates a function from the n Gauss-Legendre points x */
+/* with weights w in [x_low, x_high] (in increasing order, as given by abs_and_weights) to the m points y */
+void cavity_multigrid_interpolation (double x_low, double x_high, const double *x, const double *w, int n, const double *y, int m, double *T){
+    
+    int i, k, exact;
+    double s, b, half = 0.5*(x_high-x_low), mid = 0.5*(x_high+x_low);
+    double *c = (double *) malloc (n*sizeof(double));
+    
+    for (i=0; i<m; i++){
+        
+        exact = -1;
+        
+        for (k=0; k<n; k++){
+            
+            /* barycentric weights of the points mapped to [-1, 1] */
+            s = (*(x + k) - mid)/half;
+            b = (k%2 ? -1. : 1.) * sqrt((1.-s*s) * *(w + k)/half);
+            
+            if (*(y + i) == *(x + k))
+                exact = k;
+            else
+                *(c + k) = b/(*(y + i) - *(x + k));
+        }
+        
+        cavity_multigrid_row (T + (size_t) i*n, c, exact, n);
+    }
+    
+    free (c);
+}
+
+/* compute the m x n matrix T that interpolates a periodic function from the n points 2 pi k/n */
+/* to the m points y, with the trigonometric barycentric formula, whose terms are */
+/* (-1)^k/sin((y-x_k)/2) for odd n and (-1)^k/tan((y-x_k)/2) for even n */
+void cavity_multigrid_periodic_interpolation (int n, const double *y, int m, double *T){
+    
+    int i, k, exact;
+    double d, *c = (double *) malloc (n*sizeof(double));
+    
+    for (i=0; i<m; i++){
+        
+        exact = -1;
+        
+        for (k=0; k<n; k++){
+            
+            d = 0.5*(*(y + i) - 2*M_PI*k/n);
+            
+            if (fabs(sin(d)) < 1.e-14)
+                exact = k;
+            else
+                *(c + k) = (k%2 ? -1. : 1.)/(n%2 ? sin(d) : tan(d));
+        }
+        
+        cavity_multigrid_row (T + (size_t) i*n, c, exact, n);
+    }
+    
+    free (c);
+}
+
+/* interpolate the marginal p_coarse on the Ntheta_c x Nphi_c grid to p on the Ntheta x Nphi grid, */
+/* with the matrices T_theta (Ntheta x Ntheta_c) and T_phi (Nphi x Nphi_c): p = T_theta p_coarse T_phi^T, */
+/* using work (Ntheta x Nphi_c) for the intermediate product. The interpolation may undershoot in the */
+/* tails of a peaked marginal, and p is then not positive everywhere */
+void cavity_multigrid_prolong (const double *T_theta, const double *T_phi, const double *p_coarse, int Ntheta_c, int Nphi_c, double *p, int Ntheta, int Nphi, double *work){
+    
+    cblas_dgemm (CblasRowMajor, CblasNoTrans, CblasNoTrans, Ntheta, Nphi_c, Ntheta_c, 1., T_theta, Ntheta_c, p_coarse, Nphi_c, 0., work, Nphi_c);
+    cblas_dgemm (CblasRowMajor, CblasNoTrans, CblasTrans, Ntheta, Nphi, Nphi_c, 1., work, Nphi_c, T_phi, Nphi_c, 0., p, Nphi);
+}
@@ -0,0 +1,30 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __CAVITY_MULTIGRID_H__
+#define __CAVITY_MULTIGRID_H__
+
+/* interpolation of a marginal from a coarse grid to a finer one, for the coarse-to-fine solution of the */
+/* cavity equations: the interpolation is separable, first in cos(theta) then in phi, and each of them */
+/* is a small dense matrix, computed once with the barycentric formula of the coarse points */
+
+void cavity_multigrid_interpolation (double, double, const double *, const double *, int, const double *, int, double *);
+
+void cavity_multigrid_periodic_interpolation (int, const double *, int, double *);
+
+void cavity_multigrid_prolong (const double *, const double *, const double *, int, int, double *, int, int, double *);
+
+#endif
@@ -24,4 +24,6 @@
 
 void cavity_compute_scalar_products (cavity_workspace *);
 
+void cavity_compute_scalar_factors (cavity_workspace *);
+
 #endif
@@ -0,0 +1,111 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <string.h>
+#include "cavity_simd.h"
+
+/******************************************************************
+ *                                                                *
+ *  SIMD construction of the Boltzmann kernel                     *
+ *  w(u) * exp(J * t*u - |J|), with a vectorised polynomial exp:  *
+ *  exp(x) = 2^k exp(r), with k = round(x/ln 2) and               *
+ *  |r| <= ln 2 / 2, where exp(r) is its Taylor series up to      *
+ *  r^13 / 13!, accurate to the last bit of a double.             *
+ *                                                                *
+ *****************************************************************/
+
+#if defined(__GNUC__)
+
+typedef double cavity_vdouble __attribute__ ((vector_size (__SIMD_WIDTH__*sizeof(double))));
+typedef long long cavity_vlong __attribute__ ((vector_size (__SIMD_WIDTH__*sizeof(long long))));
+
+/* x = exp(x) for |x| <= 708, where 2^k is a normal double; smaller x are clamped to -708 */
+/* the vector is passed by address, so that the function does not depend on the vector ABI of the target */
+static inline __attribute__ ((always_inline)) void cavity_simd_exp (cavity_vdouble *px){
+    
+    /* adding 1.5 * 2^52 rounds x/ln 2 to an integer, stored in the low bits of the mantissa */
+    const double shifter = 6755399441055744.;
+    cavity_vdouble x = *px, zero = x-x, kd, r, p, low = zero - 708.;
+    cavity_vlong k, under = x < low;
+    
+    /* exp(-708) is as negligible as the exp(x) that underflow, and keeps 2^k normal */
+    x = (cavity_vdouble) (((cavity_vlong) x & ~under) | ((cavity_vlong) low & under));
+    
+    kd = x * 1.44269504088896338700e+00 + shifter;
+    k = (cavity_vlong) kd - (cavity_vlong) (zero + shifter);
+    kd -= shifter;
+    
+    /* reduced argument, with ln 2 split in two parts so that kd * ln2_hi is exact */
+    r = x - kd * 6.93147180369123816490e-01 - kd * 1.90821492927058770002e-10;
+    
+    p = r * (1./6227020800.) + 1./479001600.;
+    p = p*r + 1./39916800.;
+    p = p*r + 1./3628800.;
+    p = p*r + 1./362880.;
+    p = p*r + 1./40320.;
+    p = p*r + 1./5040.;
+    p = p*r + 1./720.;
+    p = p*r + 1./120.;
+    p = p*r + 1./24.;
+    p = p*r + 1./6.;
+    p = p*r + 0.5;
+    p = p*r + 1.;
+    p = p*r + 1.;
+    
+    /* scale by 2^k, built from its exponent bits */
+    *px = p * (cavity_vdouble) ((k + 1023) << 52);
+}
+
+/* compute a row of the Boltzmann kernel, K(u) = w(u) * exp(J * t*u - |J|) for the n scalar products s = t*u */
+/* since |t*u| <= 1, the arguments of exp are in [-2|J|, 0]: the kernel cannot overflow whatever J, */
+/* and its largest values, on the diagonal, are w(u) */
+__SIMD_DISPATCH__
+void cavity_simd_kernel_row (double *K, const double *s, const double *weight, double JB, int n) {
+    
+    int j=0;
+    double shift = fabs(JB);
+    cavity_vdouble vs, vw;
+    
+    for (; j+__SIMD_WIDTH__ <= n; j+=__SIMD_WIDTH__){
+        
+        memcpy (&vs, s+j, sizeof(vs));
+        memcpy (&vw, weight+j, sizeof(vw));
+        
+        vs = vs*JB - shift;
+        cavity_simd_exp (&vs);
+        vs *= vw;
+        
+        memcpy (K+j, &vs, sizeof(vs));
+    }
+    
+    /* remaining points */
+    for (; j<n; j++)
+        *(K+j) = *(weight+j) * exp(*(s+j)*JB - shift);
+}
+
+#else
+
+/* compute a row of the Boltzmann kernel, K(u) = w(u) * exp(J * t*u - |J|) for the n scalar products s = t*u */
+void cavity_simd_kernel_row (double *K, const double *s, const double *weight, double JB, int n) {
+    
+    int j;
+    
+    for (j=0; j<n; j++)
+        *(K+j) = *(weight+j) * exp(*(s+j)*JB - fabs(JB));
+}
+
+#endif
@@ -0,0 +1,42 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __CAVITY_SIMD_H__
+#define __CAVITY_SIMD_H__
+
+/* the SIMD kernels are written with the vector extensions of GCC and clang, on vectors of */
+/* __SIMD_WIDTH__ doubles: one AVX-512 register, two AVX2 registers or four SSE2 registers */
+#ifndef __SIMD_WIDTH__
+
+#define __SIMD_WIDTH__ 8
+
+#endif
+
+/* on x86-64 ELF platforms, the SIMD kernels are compiled for AVX-512, AVX2 and the baseline SSE2, */
+/* and the version for the CPU at hand is chosen by the dynamic loader */
+#if defined(__x86_64__) && defined(__ELF__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define __SIMD_DISPATCH__ __attribute__ ((target_clones ("avx512f", "avx2", "default")))
+#endif
+#endif
+
+#ifndef __SIMD_DISPATCH__
+#define __SIMD_DISPATCH__
+#endif
+
+void cavity_simd_kernel_row (double *, const double *, const double *, double, int);
+
+#endif
@@ -0,0 +1,267 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <math.h>
+#include <gsl/gsl_errno.h>
+#include "cavity_solver.h"
+#include "cavity_alloc.h"
+#include "cavity_init.h"
+#include "cavity_gradient_alloc.h"
+#include "cavity_gradient_init.h"
+
+/* allocate a cavity solver with the given parameters */
+wlc_cavity_solver *wlc_cavity_solver_alloc (const wlc_cavity_params *params){
+    
+    wlc_cavity_solver *solver = (wlc_cavity_solver *) malloc (sizeof(wlc_cavity_solver));
+    
+    solver -> params = *params;
+    
+    /* the workspaces are allocated and initialised by the first evaluation that needs them */
+    solver -> cav_w = NULL;
+    solver -> cav_grad_w = NULL;
+    
+    solver -> iter = 0;
+    solver -> status = GSL_SUCCESS;
+    solver -> log_lambda = -HUGE_VAL;
+    
+    return solver;
+}
+
+/* free the cavity solver and its workspaces */
+void wlc_cavity_solver_free (wlc_cavity_solver *solver){
+    
+    if (solver -> cav_w)
+        cavity_workspace_free (solver -> cav_w);
+    
+    if (solver -> cav_grad_w)
+        cavity_gradient_workspace_free (solver -> cav_grad_w);
+    
+    free (solver);
+}
+
+/* get the workspace of the solver ready for a new evaluation of rho */
+static void cavity_solver_prepare (wlc_cavity_solver *solver){
+    
+    if (solver -> cav_w == NULL){
+        
+        /* first evaluation: compute the grid and the scalar products once and for all */
+        solver -> cav_w = cavity_workspace_alloc (&solver -> params);
+        cavity_workspace_initialise (solver -> cav_w);
+    }
+    else
+        /* start the iteration from the uniform marginal */
+        cavity_initialise_marginal (solver -> cav_w);
+}
+
+/* compute cavity elongation rho as a function of force F, reusing the workspace of the solver */
+double wlc_cavity_solver_rho_F (wlc_cavity_solver *solver, double f, double bB, double JB){
+    
+    double l;
+    
+    cavity_solver_prepare (solver);
+    
+    l = wlc_rho_F_cavity_workspace (solver -> cav_w, f, bB, JB);
+    
+    solver -> iter = solver -> cav_w -> iter;
+    solver -> status = solver -> cav_w -> status;
+    solver -> log_lambda = log (solver -> cav_w -> lambda) + solver -> cav_w -> log_scale;
+    
+    return l;
+}
+
+/* compute cavity elongation rho, its gradient and the correlation length, reusing the workspace of the solver */
+double wlc_cavity_solver_rho_F_and_gradient (wlc_cavity_solver *solver, double f, double bB, double JB, double *drho_dbB, double *drho_dJB, double *xi_f){
+    
+    double l;
+    
+    if (solver -> cav_grad_w == NULL){
+        
+        /* first evaluation: compute the grid and the scalar products once and for all */
+        solver -> cav_grad_w = cavity_gradient_workspace_alloc (&solver -> params);
+        cavity_gradient_workspace_initialise (solver -> cav_grad_w);
+    }
+    else
+        /* start the iteration from the uniform marginal */
+        cavity_gradient_initialise_marginal (solver -> cav_grad_w);
+    
+    l = wlc_rho_F_cavity_and_gradient_workspace (solver -> cav_grad_w, f, bB, JB, drho_dbB, drho_dJB, xi_f);
+    
+    solver -> iter = solver -> cav_grad_w -> iter;
+    solver -> status = solver -> cav_grad_w -> status;
+    solver -> log_lambda = log (solver -> cav_grad_w -> lambda) + solver -> cav_grad_w -> log_scale;
+    
+    return l;
+}
+
+/* compute cavity elongation rho for the n forces f[k] at fixed bB, JB, storing it in rho[k] */
+/* the converged marginal at each force is used as the starting point of the next one, */
+/* or, in block mode, at the last force of a block as the starting point of the next block */
+void wlc_cavity_solver_rho_F_curve (wlc_cavity_solver *solver, const double *f, size_t n, double bB, double JB, double *rho){
+    
+    size_t k, m;
+    
+    if (n==0)
+        return;
+    
+    cavity_solver_prepare (solver);
+    
+    /* iterate the forces by blocks, each sweep being a matrix-matrix product */
+    if (solver -> cav_w -> block){
+        
+        solver -> iter = 0;
+        solver -> status = GSL_SUCCESS;
+        
+        for (k=0; k<n; k+=m){
+            
+            m = n-k < (size_t) solver -> cav_w -> block -> m ? n-k : (size_t) solver -> cav_w -> block -> m;
+            
+            wlc_rho_F_cavity_block_workspace (solver -> cav_w, f+k, (int) m, bB, JB, rho+k);
+            
+            solver -> iter += solver -> cav_w -> iter;
+            
+            if (solver -> cav_w -> status != GSL_SUCCESS)
+                solver -> status = solver -> cav_w -> status;
+            
+            solver -> log_lambda = log (solver -> cav_w -> lambda) + solver -> cav_w -> log_scale;
+        }
+        
+        return;
+    }
+    
+    /* the first force starts from the uniform marginal */
+    rho[0] = wlc_cavity_solver_rho_F (solver, f[0], bB, JB);
+    
+    /* the following ones from the marginal left by the previous force */
+    for (k=1; k<n; k++){
+        
+        rho[k] = wlc_rho_F_cavity_workspace (solver -> cav_w, f[k], bB, JB);
+        
+        solver -> iter += solver -> cav_w -> iter;
+        
+        if (solver -> cav_w -> status != GSL_SUCCESS)
+            solver -> status = solver -> cav_w -> status;
+        
+        solver -> log_lambda = log (solver -> cav_w -> lambda) + solver -> cav_w -> log_scale;
+    }
+}
+
+/* compute cavity elongation rho, its gradient and the correlation length for the n forces f[k] at fixed bB, JB */
+/* the converged marginal and its derivatives at each force are used as the starting point of the next one */
+void wlc_cavity_solver_rho_F_and_gradient_curve (wlc_cavity_solver *solver, const double *f, size_t n, double bB, double JB, double *rho, double *drho_dbB, double *drho_dJB, double *xi_f){
+    
+    size_t k;
+    
+    if (n==0)
+        return;
+    
+    /* the first force starts from the uniform marginal */
+    rho[0] = wlc_cavity_solver_rho_F_and_gradient (solver, f[0], bB, JB, drho_dbB, drho_dJB, xi_f);
+    
+    /* the following ones from the marginals left by the previous force */
+    for (k=1; k<n; k++){
+        
+        rho[k] = wlc_rho_F_cavity_and_gradient_workspace (solver -> cav_grad_w, f[k], bB, JB, drho_dbB+k, drho_dJB+k, xi_f+k);
+        
+        solver -> iter += solver -> cav_grad_w -> iter;
+        
+        if (solver -> cav_grad_w -> status != GSL_SUCCESS)
+            solver -> status = solver -> cav_grad_w -> status;
+        
+        solver -> log_lambda = log (solver -> cav_grad_w -> lambda) + solver -> cav_grad_w -> log_scale;
+    }
+}
+
+/* compute the observables selected by mask from a single solve at force f: the marginal alone */
+/* gives rho, its variance and the free energy, the gradient of the marginal is only iterated */
+/* when one of drho/dbB, drho/dJB, xi_f or drho/df is requested */
+int wlc_cavity_solver_observables (wlc_cavity_solver *solver, double f, double bB, double JB, unsigned int mask, wlc_cavity_observables *obs){
+    
+    double rho, drho_dbB, drho_dJB, xi_f, variance, g, h;
+    
+    if (mask & (WLC_CAVITY_DRHO_DBB | WLC_CAVITY_DRHO_DJB | WLC_CAVITY_XI | WLC_CAVITY_DRHO_DF)){
+        
+        /* rho only depends on f*bB: g is its derivative wrt f*bB, i.e. drho/dbB / f; at f = 0, where */
+        /* drho/dbB vanishes, f and bB are exchanged so that the derivative is taken wrt the force instead, */
+        /* and if bB = 0 as well, a unit force gives the same uniform field and the derivative at f*bB = 0 */
+        if (f == 0.){
+            
+            h = bB != 0. ? bB : 1.;
+            
+            rho = wlc_cavity_solver_rho_F_and_gradient (solver, h, f, JB, &drho_dbB, &drho_dJB, &xi_f);
+            g = drho_dbB/h;
+        }
+        else {
+            
+            rho = wlc_cavity_solver_rho_F_and_gradient (solver, f, bB, JB, &drho_dbB, &drho_dJB, &xi_f);
+            g = drho_dbB/f;
+        }
+        
+        variance = solver -> cav_grad_w -> variance;
+        
+        if (mask & WLC_CAVITY_DRHO_DBB)
+            obs -> drho_dbB = f*g;
+        
+        if (mask & WLC_CAVITY_DRHO_DJB)
+            obs -> drho_dJB = drho_dJB;
+        
+        /* Eq. (13) of Massucci et al. (2014), as in wlc_rho_F_cavity_and_gradient_workspace */
+        if (mask & WLC_CAVITY_XI)
+            obs -> xi_f = -bB/(log(g - variance) - log(g + variance));
+        
+        if (mask & WLC_CAVITY_DRHO_DF)
+            obs -> drho_df = bB*g;
+    }
+    else {
+        
+        rho = wlc_cavity_solver_rho_F (solver, f, bB, JB);
+        
+        variance = solver -> cav_w -> variance;
+    }
+    
+    if (mask & WLC_CAVITY_RHO)
+        obs -> rho = rho;
+    
+    if (mask & WLC_CAVITY_VARIANCE)
+        obs -> variance = variance;
+    
+    if (mask & WLC_CAVITY_FREE_ENERGY)
+        obs -> free_energy = -solver -> log_lambda;
+    
+    return solver -> status;
+}
+
+/* number of iterations of the cavity equations done by the last evaluation, */
+/* or by the whole curve for the curve functions */
+unsigned int wlc_cavity_solver_iter (const wlc_cavity_solver *solver){
+    
+    return solver -> iter;
+}
+
+/* status of the last evaluation, or the first failure of the whole curve for the curve functions: */
+/* GSL_SUCCESS, or GSL_CONTINUE if the iteration stopped at max_iter before converging */
+int wlc_cavity_solver_status (const wlc_cavity_solver *solver){
+    
+    return solver -> status;
+}
+
+/* free energy per segment, in units of kT, at the last force evaluated: minus the logarithm */
+/* of the leading eigenvalue of the transfer operator diag(exp(b_B * f * z*t)) * kernel */
+double wlc_cavity_solver_free_energy (const wlc_cavity_solver *solver){
+    
+    return -solver -> log_lambda;
+}
@@ -0,0 +1,51 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CAVITY_SOLVER_H__
+#define __CAVITY_SOLVER_H__
+
+#include "wlc.h"
+#include "cavity.h"
+#include "cavity_gradient.h"
+
+/* a cavity solver keeps the workspaces, and thus the grid, the scalar products and */
+/* the kernel, alive between evaluations. Each workspace is allocated on first use */
+struct wlc_cavity_solver {
+    
+    wlc_cavity_params params;
+    
+    cavity_workspace *cav_w;
+    
+    cavity_gradient_workspace *cav_grad_w;
+    
+    /* number of iterations done by the last evaluation, and its status (the first failure along a curve) */
+    unsigned int iter;
+    int status;
+    
+    /* logarithm of the leading eigenvalue of the transfer operator at the last force evaluated, */
+    /* which, unlike the eigenvalue itself, does not overflow at large JB or f */
+    double log_lambda;
+};
+
+/* evaluation of the observables on an initialised workspace, defined in wlc.c */
+double wlc_rho_F_cavity_workspace (cavity_workspace *, double, double, double);
+
+void wlc_rho_F_cavity_block_workspace (cavity_workspace *, const double *, int, double, double, double *);
+
+double wlc_rho_F_cavity_and_gradient_workspace (cavity_gradient_workspace *, double, double, double, double *, double *, double *);
+
+#endif
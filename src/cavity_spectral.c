@@ -0,0 +1,100 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include <math.h>
+#include <gsl/gsl_cblas.h>
+#include <gsl/gsl_sf_bessel.h>
+#include <gsl/gsl_sf_legendre.h>
+#include "cavity_spectral.h"
+
+/******************************************************************
+ *                                                                *
+ *  Spectral products with the axisymmetric Boltzmann kernel:     *
+ *  the marginal on the Gauss-Legendre points in cos(theta) is    *
+ *  transformed to its Legendre coefficients, multiplied by the   *
+ *  eigenvalues of the kernel, and transformed back. With as many *
+ *  polynomials as points, the transforms are exact for a band-   *
+ *  limited marginal, and the truncation of the kernel converges  *
+ *  exponentially once L exceeds ~J.                              *
+ *                                                                *
+ *****************************************************************/
+
+/* allocate the transforms for Ntheta points and as many Legendre polynomials */
+cavity_spectral *cavity_spectral_alloc (int Ntheta){
+    
+    cavity_spectral *sp = (cavity_spectral *) malloc (sizeof(cavity_spectral));
+    
+    sp -> Ntheta = Ntheta;
+    sp -> L = Ntheta;
+    
+    sp -> legendre = (double *) malloc ((size_t) Ntheta*sp -> L*sizeof(double));
+    sp -> forward = (double *) malloc ((size_t) Ntheta*sp -> L*sizeof(double));
+    sp -> eigenvalue = (double *) malloc (sp -> L*sizeof(double));
+    sp -> coef = (double *) malloc (sp -> L*sizeof(double));
+    
+    return sp;
+}
+
+/* free the transforms */
+void cavity_spectral_free (cavity_spectral *sp){
+    
+    free (sp -> legendre);
+    free (sp -> forward);
+    free (sp -> eigenvalue);
+    free (sp -> coef);
+    
+    free (sp);
+}
+
+/* compute the Legendre polynomials on the Gauss-Legendre points cos_theta with weights w_cos_theta */
+void cavity_spectral_initialise (cavity_spectral *sp, const double *cos_theta, const double *w_cos_theta){
+    
+    int k, l, L = sp -> L, Ntheta = sp -> Ntheta;
+    
+    for (k=0; k<Ntheta; k++){
+        
+        gsl_sf_legendre_Pl_array (L-1, *(cos_theta + k), sp -> legendre + (size_t) k*L);
+        
+        for (l=0; l<L; l++)
+            *(sp -> forward + (size_t) l*Ntheta + k) = 0.5*(2*l+1) * *(w_cos_theta + k) * *(sp -> legendre + (size_t) k*L + l);
+    }
+}
+
+/* compute the eigenvalues 4 pi i_l(J) of the kernel scaled by exp(-|J|), as all the kernels, */
+/* which are the scaled Bessel functions exp(-|J|) i_l(J) and cannot overflow */
+void cavity_spectral_compute_kernel (cavity_spectral *sp, double JB){
+    
+    int l;
+    
+    gsl_sf_bessel_il_scaled_array (sp -> L-1, JB, sp -> eigenvalue);
+    
+    for (l=0; l<sp -> L; l++)
+        *(sp -> eigenvalue + l) *= 4*M_PI;
+}
+
+/* compute out = K * p: coefficients of p, times the eigenvalues, back to the points */
+void cavity_spectral_product (cavity_spectral *sp, const double *p, double *out){
+    
+    int l;
+    
+    cblas_dgemv (CblasRowMajor, CblasNoTrans, sp -> L, sp -> Ntheta, 1., sp -> forward, sp -> Ntheta, p, 1, 0., sp -> coef, 1);
+    
+    for (l=0; l<sp -> L; l++)
+        *(sp -> coef + l) *= *(sp -> eigenvalue + l);
+    
+    cblas_dgemv (CblasRowMajor, CblasNoTrans, sp -> Ntheta, sp -> L, 1., sp -> legendre, sp -> L, sp -> coef, 1, 0., out, 1);
+}
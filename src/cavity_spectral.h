@@ -0,0 +1,54 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __CAVITY_SPECTRAL_H__
+#define __CAVITY_SPECTRAL_H__
+
+/* spectral representation of an axisymmetric marginal, P(t) = sum_l a_l P_l(cos(theta)) for l < L, */
+/* with P_l the Legendre polynomials. By the Funk-Hecke theorem, the integral of exp(J * t*u) P_l(u) */
+/* over u is 4 pi i_l(J) P_l(t), with i_l the modified spherical Bessel functions: the kernel of */
+/* Eq. (9) of Massucci et al. (2014) is diagonal in this basis */
+typedef struct {
+    
+    /* number of Gauss-Legendre points in cos(theta) and of Legendre polynomials */
+    int Ntheta;
+    int L;
+    
+    /* P_l(cos(theta_k)), stored as [k*L + l] */
+    double *legendre;
+    
+    /* forward transform (2l+1)/2 w_k P_l(cos(theta_k)), stored as [l*Ntheta + k] */
+    double *forward;
+    
+    /* eigenvalues 4 pi i_l(J) of the kernel */
+    double *eigenvalue;
+    
+    /* Legendre coefficients of the marginal */
+    double *coef;
+    
+} cavity_spectral;
+
+cavity_spectral *cavity_spectral_alloc (int);
+
+void cavity_spectral_free (cavity_spectral *);
+
+void cavity_spectral_initialise (cavity_spectral *, const double *, const double *);
+
+void cavity_spectral_compute_kernel (cavity_spectral *, double);
+
+void cavity_spectral_product (cavity_spectral *, const double *, double *);
+
+#endif
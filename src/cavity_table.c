@@ -0,0 +1,260 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include <math.h>
+#include "cavity_table.h"
+#include "cavity_macros.h"
+
+/******************************************************************
+ *                                                                *
+ *  Tabulated cavity elongation rho(x = f*bB, JB), interpolated   *
+ *  by bicubic Hermite polynomials on each cell of a uniform      *
+ *  grid in (u, JB), with x = x0 sinh(u) to resolve the steep     *
+ *  rise of rho at small forces, from the values of rho and its   *
+ *  derivatives given by the solver at the nodes. The cross       *
+ *  derivative is obtained by finite differences along JB.        *
+ *                                                                *
+ *****************************************************************/
+
+/* allocate and build a table of rho over 0 <= f*bB <= x_max and JB_min <= JB <= JB_max, */
+/* on a grid of nx x nJ nodes (at least 2 x 2, or the program exits), using a cavity solver with the given parameters */
+wlc_cavity_table *wlc_cavity_table_alloc (const wlc_cavity_params *params, double x_max, double JB_min, double JB_max, size_t nx, size_t nJ){
+    
+    size_t i, j, n = nx*nJ;
+    double *x, *rho, *drho_dbB, *drho_dJB, *xi;
+    double JB, drho, rho_t;
+    wlc_cavity_table *table;
+    
+    /* the nodes must span a cell in both directions */
+    if (nx < 2 || nJ < 2 || !(x_max > 0.) || !(JB_max > JB_min)){
+        
+        wlc_error ("wlc_cavity_table_alloc: the table needs at least 2 x 2 nodes over x_max > 0 and JB_max > JB_min (nx = %lu, nJ = %lu, x_max = %g, JB_min = %g, JB_max = %g)\n", (unsigned long) nx, (unsigned long) nJ, x_max, JB_min, JB_max);
+        exit (EXIT_FAILURE);
+    }
+    
+    table = (wlc_cavity_table *) malloc (sizeof(wlc_cavity_table));
+    
+    table -> nx = nx;
+    table -> nJ = nJ;
+    table -> hu = asinh(x_max/__TABLE_SCALE__)/(nx-1);
+    table -> JB_min = JB_min;
+    table -> hJ = (JB_max-JB_min)/(nJ-1);
+    
+    table -> rho = (double *) malloc (n*sizeof(double));
+    table -> rho_u = (double *) malloc (n*sizeof(double));
+    table -> rho_J = (double *) malloc (n*sizeof(double));
+    table -> rho_uJ = (double *) malloc (n*sizeof(double));
+    
+    table -> solver = wlc_cavity_solver_alloc (params);
+    
+    x = (double *) malloc (nx*sizeof(double));
+    rho = (double *) malloc (nx*sizeof(double));
+    drho_dbB = (double *) malloc (nx*sizeof(double));
+    drho_dJB = (double *) malloc (nx*sizeof(double));
+    xi = (double *) malloc (nx*sizeof(double));
+    
+    for (i=0; i<nx; i++)
+        x[i] = __TABLE_SCALE__*sinh(i*table -> hu);
+    
+    for (j=0; j<nJ; j++){
+        
+        JB = JB_min + j*table -> hJ;
+        
+        /* at x = 0, rho = 0 and its derivative wrt x is the one wrt bB at f = 1, bB = 0 */
+        table -> rho [j] = wlc_cavity_solver_rho_F_and_gradient (table -> solver, 1., 0., JB, &drho, table -> rho_J + j, xi);
+        table -> rho_u [j] = drho*__TABLE_SCALE__;
+        
+        /* the other nodes along a force-extension curve at bB = 1, where drho/dbB = x drho/dx */
+        wlc_cavity_solver_rho_F_and_gradient_curve (table -> solver, x+1, nx-1, 1., JB, rho, drho_dbB, drho_dJB, xi);
+        
+        for (i=1; i<nx; i++){
+            
+            table -> rho [i*nJ+j] = rho[i-1];
+            table -> rho_u [i*nJ+j] = drho_dbB[i-1]/x[i]*__TABLE_SCALE__*cosh(i*table -> hu);
+            table -> rho_J [i*nJ+j] = drho_dJB[i-1];
+        }
+    }
+    
+    /* cross derivative: centred differences of drho/du along JB, one-sided at the ends, */
+    /* where they are of second order as well if there are at least 3 nodes */
+    for (i=0; i<nx; i++)
+        for (j=0; j<nJ; j++){
+            
+            const double *r = table -> rho_u + i*nJ;
+            
+            if (j>0 && j<nJ-1)
+                table -> rho_uJ [i*nJ+j] = (r[j+1] - r[j-1])/(2.*table -> hJ);
+            else if (nJ < 3)
+                table -> rho_uJ [i*nJ+j] = (r[1] - r[0])/table -> hJ;
+            else if (j == 0)
+                table -> rho_uJ [i*nJ+j] = (-3.*r[0] + 4.*r[1] - r[2])/(2.*table -> hJ);
+            else
+                table -> rho_uJ [i*nJ+j] = (3.*r[j] - 4.*r[j-1] + r[j-2])/(2.*table -> hJ);
+        }
+    
+    /* error estimate: compare with the solver at the centres of the cells */
+    table -> error = 0.;
+    
+    for (i=0; i<nx-1; i++)
+        x[i] = __TABLE_SCALE__*sinh((i+0.5)*table -> hu);
+    
+    for (j=0; j<nJ-1; j++){
+        
+        JB = JB_min + (j+0.5)*table -> hJ;
+        
+        wlc_cavity_solver_rho_F_curve (table -> solver, x, nx-1, 1., JB, rho);
+        
+        for (i=0; i<nx-1; i++){
+            
+            rho_t = wlc_cavity_table_rho_F (table, x[i], 1., JB);
+            
+            if (fabs(rho_t-rho[i]) > table -> error)
+                table -> error = fabs(rho_t-rho[i]);
+        }
+    }
+    
+    free (x);
+    free (rho);
+    free (drho_dbB);
+    free (drho_dJB);
+    free (xi);
+    
+    return table;
+}
+
+/* free the table */
+void wlc_cavity_table_free (wlc_cavity_table *table){
+    
+    free (table -> rho);
+    free (table -> rho_u);
+    free (table -> rho_J);
+    free (table -> rho_uJ);
+    
+    wlc_cavity_solver_free (table -> solver);
+    
+    free (table);
+}
+
+/* estimate of the interpolation error: the largest difference between the table and the solver */
+/* sampled at the centres of the cells, which is not a bound on the error elsewhere */
+double wlc_cavity_table_error (const wlc_cavity_table *table){
+    
+    return table -> error;
+}
+
+/* interpolate rho and its derivatives wrt x and JB at (x >= 0, JB) inside the table */
+static double cavity_table_interpolate (const wlc_cavity_table *table, double x, double JB, double *rho_x, double *rho_J){
+    
+    size_t i, j, a, b, k;
+    double t, u, v, A[2], B[2], dA[2], dB[2], C[2], D[2], dC[2], dD[2], rho=0.;
+    
+    /* cell and position inside it */
+    v = asinh(x/__TABLE_SCALE__);
+    t = v/table -> hu;
+    u = (JB - table -> JB_min)/table -> hJ;
+    
+    i = (size_t) t < table -> nx-2 ? (size_t) t : table -> nx-2;
+    j = (size_t) u < table -> nJ-2 ? (size_t) u : table -> nJ-2;
+    
+    t -= i;
+    u -= j;
+    
+    /* cubic Hermite basis: A for the values at the two ends, B for the derivatives, and their derivatives */
+    A[0] = (2*t-3)*t*t+1;
+    A[1] = (3-2*t)*t*t;
+    B[0] = ((t-2)*t+1)*t;
+    B[1] = (t-1)*t*t;
+    dA[0] = 6*t*(t-1);
+    dA[1] = -dA[0];
+    dB[0] = (3*t-4)*t+1;
+    dB[1] = (3*t-2)*t;
+    
+    C[0] = (2*u-3)*u*u+1;
+    C[1] = (3-2*u)*u*u;
+    D[0] = ((u-2)*u+1)*u;
+    D[1] = (u-1)*u*u;
+    dC[0] = 6*u*(u-1);
+    dC[1] = -dC[0];
+    dD[0] = (3*u-4)*u+1;
+    dD[1] = (3*u-2)*u;
+    
+    *rho_x = 0.;
+    *rho_J = 0.;
+    
+    for (a=0; a<2; a++)
+        for (b=0; b<2; b++){
+            
+            k = (i+a)*table -> nJ + j+b;
+            
+            rho += table -> rho[k]*A[a]*C[b] + table -> rho_u[k]*table -> hu*B[a]*C[b]
+                 + table -> rho_J[k]*table -> hJ*A[a]*D[b] + table -> rho_uJ[k]*table -> hu*table -> hJ*B[a]*D[b];
+            
+            *rho_x += (table -> rho[k]*dA[a]*C[b] + table -> rho_u[k]*table -> hu*dB[a]*C[b]
+                     + table -> rho_J[k]*table -> hJ*dA[a]*D[b] + table -> rho_uJ[k]*table -> hu*table -> hJ*dB[a]*D[b])/table -> hu;
+            
+            *rho_J += (table -> rho[k]*A[a]*dC[b] + table -> rho_u[k]*table -> hu*B[a]*dC[b]
+                     + table -> rho_J[k]*table -> hJ*A[a]*dD[b] + table -> rho_uJ[k]*table -> hu*table -> hJ*B[a]*dD[b])/table -> hJ;
+        }
+    
+    /* from the derivative wrt u to the one wrt x */
+    *rho_x /= __TABLE_SCALE__*cosh(v);
+    
+    return rho;
+}
+
+/* check whether (x, JB) is covered by the table */
+static int cavity_table_inside (const wlc_cavity_table *table, double x, double JB){
+    
+    return fabs(x) <= __TABLE_SCALE__*sinh((table -> nx-1)*table -> hu) && JB >= table -> JB_min && JB <= table -> JB_min + (table -> nJ-1)*table -> hJ;
+}
+
+/* compute cavity elongation rho as a function of force F from the table, */
+/* or with the solver of the table outside of it */
+double wlc_cavity_table_rho_F (wlc_cavity_table *table, double f, double bB, double JB){
+    
+    double x = f*bB, rho_x, rho_J;
+    
+    if (!cavity_table_inside (table, x, JB))
+        return wlc_cavity_solver_rho_F (table -> solver, f, bB, JB);
+    
+    /* rho is odd in x */
+    return x < 0. ? -cavity_table_interpolate (table, -x, JB, &rho_x, &rho_J) : cavity_table_interpolate (table, x, JB, &rho_x, &rho_J);
+}
+
+/* compute cavity elongation rho and its gradient wrt bB and JB from the table, */
+/* or with the solver of the table outside of it */
+double wlc_cavity_table_rho_F_and_gradient (wlc_cavity_table *table, double f, double bB, double JB, double *drho_dbB, double *drho_dJB){
+    
+    double x = f*bB, rho, rho_x, xi;
+    
+    if (!cavity_table_inside (table, x, JB))
+        return wlc_cavity_solver_rho_F_and_gradient (table -> solver, f, bB, JB, drho_dbB, drho_dJB, &xi);
+    
+    /* rho and its derivative wrt JB are odd in x, the one wrt x is even */
+    rho = cavity_table_interpolate (table, fabs(x), JB, &rho_x, drho_dJB);
+    
+    if (x < 0.){
+        
+        rho = -rho;
+        *drho_dJB = -*drho_dJB;
+    }
+    
+    /* drho/dbB = f drho/dx */
+    *drho_dbB = f*rho_x;
+    
+    return rho;
+}
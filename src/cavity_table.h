@@ -0,0 +1,47 @@
+/* wlc, a simple library to calculate worm-like chain polymer functions
+*
+* Copyright (C) 2014, 2015  Ruggero Cortini, Francesco A. Massucci
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __CAVITY_TABLE_H__
+#define __CAVITY_TABLE_H__
+
+#include "wlc.h"
+
+/* a table of the cavity elongation rho and its derivatives as a function of x = f*bB and JB, */
+/* since f and bB only enter the cavity equations through the field factor exp(f*bB * z*t). */
+/* rho is odd in x, so that only x >= 0 is tabulated */
+struct wlc_cavity_table {
+    
+    /* nodes x_i = x0 sinh(i*hu), i < nx, and JB_j = JB_min + j*hJ, j < nJ */
+    size_t nx;
+    size_t nJ;
+    double hu;
+    double JB_min;
+    double hJ;
+    
+    /* rho and its derivatives wrt u, JB and both at the nodes, stored as [i*nJ + j] */
+    double *rho;
+    double *rho_u;
+    double *rho_J;
+    double *rho_uJ;
+    
+    /* largest difference with the solver at the centres of the cells */
+    double error;
+    
+    /* solver used to build the table, and for the points outside of it */
+    wlc_cavity_solver *solver;
+};
+
+#endif
@@ -15,6 +15,7 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <stdlib.h>
 #include "wlc.h"
 #include "fit-models.h"
 #include "fdf_fit.h"
@@ -77,3 +78,115 @@ int wlc_Marko_fit (size_t n, double *x, double *y, double *sigma, gsl_vector *x_
   multifit_results_free (fit_results);
   return 0;
 }
+
+/* state of the cavity fit: the model and its derivatives are evaluated together */
+/* at all the forces of the data set each time the parameters change, */
+/* the last slot holding a force outside of the data set */
+static struct {
+  wlc_cavity_solver *solver;
+  size_t n;
+  const double *f;
+  int valid;
+  double bB;
+  double JB;
+  double *rho;
+  double *drho_dbB;
+  double *drho_dJB;
+  double *xi;
+  size_t k;
+} cavity_fit;
+
+/* returns the slot of the force f for the parameters par */
+static size_t wlc_cavity_point (double f, const gsl_vector *par) {
+  double bB = gsl_vector_get (par, 0);
+  double JB = gsl_vector_get (par, 1);
+  size_t i, n = cavity_fit.n;
+
+  /* new parameters: the whole curve at once, each force starting from the previous one */
+  if (!cavity_fit.valid || bB!=cavity_fit.bB || JB!=cavity_fit.JB) {
+    wlc_cavity_solver_rho_F_and_gradient_curve (cavity_fit.solver, cavity_fit.f, n, bB, JB,
+	cavity_fit.rho, cavity_fit.drho_dbB, cavity_fit.drho_dJB, cavity_fit.xi);
+    cavity_fit.valid = 1;
+    cavity_fit.bB = bB;
+    cavity_fit.JB = JB;
+    cavity_fit.k = 0;
+  }
+
+  /* the data points are usually visited in order */
+  if (cavity_fit.k<n && cavity_fit.f [cavity_fit.k]==f)
+    return cavity_fit.k++;
+
+  for (i=0; i<n; i++)
+    if (cavity_fit.f [i]==f) {
+      cavity_fit.k = i+1;
+      return i;
+    }
+
+  cavity_fit.rho [n] = wlc_cavity_solver_rho_F_and_gradient (cavity_fit.solver, f, bB, JB,
+      cavity_fit.drho_dbB + n, cavity_fit.drho_dJB + n, cavity_fit.xi + n);
+  return n;
+}
+
+/* cavity model */
+double wlc_cavity_f (double f, const gsl_vector *par) {
+  return cavity_fit.rho [wlc_cavity_point (f, par)];
+}
+
+/* derivative of cavity model, from the gradient of the cavity equations */
+double wlc_cavity_df (unsigned int i, double f, const gsl_vector *par) {
+  size_t k = wlc_cavity_point (f, par);
+
+  if (i==0)
+    return cavity_fit.drho_dbB [k];
+  else if (i==1)
+    return cavity_fit.drho_dJB [k];
+  else {
+    wlc_error ("Invalid i = %d\n", i);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/* fits data to cavity model */
+int wlc_cavity_fit (size_t n, double *x, double *y, double *sigma, gsl_vector *x_init, const wlc_cavity_params *params) {
+  const size_t npars = x_init->size;
+  nlin_fit_parameters fit_pars;
+  multifit_results *fit_results = multifit_results_alloc (npars);
+
+  /* initialize the state of the model */
+  cavity_fit.solver = wlc_cavity_solver_alloc (params);
+  cavity_fit.n = n;
+  cavity_fit.f = x;
+  cavity_fit.valid = 0;
+  cavity_fit.rho = (double *) malloc ((n+1)*sizeof (double));
+  cavity_fit.drho_dbB = (double *) malloc ((n+1)*sizeof (double));
+  cavity_fit.drho_dJB = (double *) malloc ((n+1)*sizeof (double));
+  cavity_fit.xi = (double *) malloc ((n+1)*sizeof (double));
+
+  /* initialize the fitter parameters */
+  fit_pars.n = n;
+  fit_pars.x = x;
+  fit_pars.y = y;
+  fit_pars.sigma = sigma;
+  fit_pars.npars = npars;
+  fit_pars.type = gsl_multifit_fdfsolver_lmsder;
+  fit_pars.eps_abs = 1.e-4;
+  fit_pars.eps_rel = 1.e-4;
+  fit_pars.max_iter = 400;
+  fit_pars.model_f = wlc_cavity_f;
+  fit_pars.model_df = wlc_cavity_df;
+
+  /* now fit */
+  nlin_fit (x_init, &fit_pars, fit_results);
+
+  /* print exit status */
+  print_multifit_results (fit_results, 1);
+
+  /* free memory and exit */
+  wlc_cavity_solver_free (cavity_fit.solver);
+  free (cavity_fit.rho);
+  free (cavity_fit.drho_dbB);
+  free (cavity_fit.drho_dJB);
+  free (cavity_fit.xi);
+  multifit_results_free (fit_results);
+  return 0;
+}
@@ -20,6 +20,7 @@
 #define __FIT_MODELS_H__
 
 #include <gsl/gsl_vector.h>
+#include "wlc.h"
 
 /* model wrappers */
 
@@ -27,7 +28,14 @@
 double wlc_Marko_f (double z, const gsl_vector *par);
 double wlc_Marko_df (unsigned int i, double z, const gsl_vector *par);
 
-/* the fit function */
+/* cavity model, parameters (bB, JB), relative extension as a function of force */
+double wlc_cavity_f (double f, const gsl_vector *par);
+double wlc_cavity_df (unsigned int i, double f, const gsl_vector *par);
+
+/* the fit functions */
 int wlc_Marko_fit (size_t n, double *x, double *y, double *sigma, gsl_vector *x_init);
 
+/* the cavity fit keeps its state between the evaluations of the model, hence is not reentrant */
+int wlc_cavity_fit (size_t n, double *x, double *y, double *sigma, gsl_vector *x_init, const wlc_cavity_params *params);
+
 #endif
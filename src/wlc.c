@@ -17,6 +17,7 @@
  */
 
 #include <stdio.h>
+#include <gsl/gsl_cblas.h>
 #include <gsl/gsl_complex.h>
 #include <gsl/gsl_complex_math.h>
 #include "f_min.h"
@@ -25,6 +26,8 @@
 #include "wlc.h"
 #include "cavity.h"
 #include "cavity_gradient.h"
+#include "cavity_solver.h"
+#include "cavity_kernel.h"
 
 
 /***************************************************************
@@ -314,78 +317,187 @@ double wlc_g_rho_highforce_derivative (double rho, void *p) {
  ***************************************************************/
 
 
-/* compute cavity elongation rho as a function of force F */
-double wlc_rho_F_cavity (double f, double bB, double JB){
+/* fill the cavity parameters with the default values */
+void wlc_cavity_params_default (wlc_cavity_params *params){
   
-    cavity_workspace *cav_w = (cavity_workspace *) cavity_workspace_alloc ();
-    int i = 0;
-    double *P, l=0., Z=0., integral;
-
-    /* initialise cavity workspace */
+    params -> Ntheta = __Ntheta__;
+    params -> Nphi = __Nphi__;
+    params -> tol = __TOL__;
+    params -> max_iter = __MAX_ITER__;
+    params -> criterion = 0;
+    params -> axisymmetric = 0;
+    params -> anderson = 0;
+    params -> eigen = 0;
+    params -> implicit = 0;
+    params -> block = 0;
+    params -> single = 0;
+    params -> lean = 0;
+    params -> periodic = 0;
+    params -> spectral = 0;
+    params -> lebedev = 0;
+    params -> adaptive = 0;
+    params -> multigrid = 0;
+}
 
-    cavity_workspace_initialise (cav_w);
+/* compute cavity elongation rho as a function of force F on an initialised workspace */
+double wlc_rho_F_cavity_workspace (cavity_workspace *cav_w, double f, double bB, double JB){
+  
+    int i = 0;
+    double *P, l=0., zeta_0=0., Z=0., integral, dZ, cos_theta;
     
     /*iterate cavity equations to get the exact cavity marginal*/
-    cavity_iterate_marginal_equations (cav_w, f, bB, JB);
+    if ((cav_w -> status = cavity_iterate_marginal_equations (cav_w, f, bB, JB))!=GSL_SUCCESS)
+        wlc_error ("wlc_rho_F_cavity: max_iter hit! f = %f\n", f);
+    
+    /* evaluate the integrals I(t) = exp(J * t*u) *P_c(u) with the kernel built by the iteration */
+    cavity_integrate_marginal (cav_w, cav_w -> marginal, cav_w -> integral);
     
     /* integrate z*t*P(t) over the unit sphere */
-    for (P= cav_w -> marginal; P< cav_w -> marginal+__Ntheta__*__Nphi__; P++){
+    for (P= cav_w -> marginal; P< cav_w -> marginal+cav_w -> npoints; P++){
         
-        /* evaluate the integral I(t) = exp(J * t*u) *P_c(u) */
-        integral = cavity_integrate_marginal (cav_w, cav_w -> marginal, JB, i*__Ntheta__*__Nphi__);
+        integral = *(cav_w -> integral + i);
         
         /* get the elongation = t*z * exp(b_B*f * t*z) * I(t)^2, Eq. (11) of Massucci et al. 2014 */
-        l += *(cav_w -> cos_theta+ i/__Nphi__) * exp(f* *(cav_w -> cos_theta+ i/__Nphi__)*bB) * integral*integral * *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__);
+        dZ = *(cav_w -> field + i) * integral*integral * *(cav_w -> weight + i);
+        
+        cos_theta = *(cav_w -> cos_theta+ i/cav_w -> Nphi);
+        
+        l += cos_theta * dZ;
+        
+        zeta_0 += cos_theta * cos_theta * dZ;
         
         /* And increase the normalisation Z */
-        Z += exp(f* *(cav_w -> cos_theta+ i/__Nphi__)*bB) * integral*integral * *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__);
+        Z += dZ;
         
         i++;
     }
     
-    /* normalise the elongation */
+    /* normalise the elongation, and keep its variance in the workspace */
     l /= Z;
     
+    cav_w -> variance = zeta_0/Z - l * l;
+    
+    return l;
+}
+
+/* compute cavity elongation rho for the m forces f[k] of a block on an initialised workspace, storing it in rho[k] */
+void wlc_rho_F_cavity_block_workspace (cavity_workspace *cav_w, const double *f, int m, double bB, double JB, double *rho){
+    
+    int i, k, n = cav_w -> npoints;
+    double l, Z, integral, dZ, *integrals;
+    cavity_block *blk = cav_w -> block;
+    
+    /*iterate cavity equations to get the exact cavity marginals of all the forces*/
+    if ((cav_w -> status = cavity_iterate_marginal_block (cav_w, f, m, bB, JB))!=GSL_SUCCESS)
+        for (k=0; k<m; k++)
+            if (!*(blk -> converged + k))
+                wlc_error ("wlc_rho_F_cavity: max_iter hit! f = %f\n", f[k]);
+    
+    /* evaluate the integrals I(t) for all the forces at once, in the spare block */
+    cblas_dgemm (CblasColMajor, CblasTrans, CblasNoTrans, n, m, n, 1., cav_w -> kernel, n, blk -> result, n, 0., blk -> marginal, n);
+    
+    for (k=0; k<m; k++){
+        
+        integrals = blk -> marginal + (size_t) k*n;
+        
+        cavity_compute_field (cav_w -> field, cav_w -> cos_theta, f[k], bB, cav_w -> Ntheta, cav_w -> Nphi);
+        
+        l = 0.;
+        Z = 0.;
+        
+        /* elongation = t*z * exp(b_B*f * t*z) * I(t)^2, Eq. (11) of Massucci et al. 2014 */
+        for (i=0; i<n; i++){
+            
+            integral = *(integrals + i);
+            
+            dZ = *(cav_w -> field + i) * integral*integral * *(cav_w -> weight + i);
+            
+            l += *(cav_w -> cos_theta+ i/cav_w -> Nphi) * dZ;
+            
+            Z += dZ;
+        }
+        
+        rho[k] = l/Z;
+    }
+}
+
+/* compute cavity elongation rho as a function of force F, with the given solver parameters */
+double wlc_rho_F_cavity_params (double f, double bB, double JB, const wlc_cavity_params *params){
+  
+    cavity_workspace *cav_w = (cavity_workspace *) cavity_workspace_alloc (params);
+    double l;
+
+    /* initialise cavity workspace */
+
+    cavity_workspace_initialise (cav_w);
+    
+    l = wlc_rho_F_cavity_workspace (cav_w, f, bB, JB);
+    
     cavity_workspace_free (cav_w);
     return l;
 }
 
+/* compute cavity elongation rho as a function of force F */
+double wlc_rho_F_cavity (double f, double bB, double JB){
+  
+    wlc_cavity_params params;
+    
+    wlc_cavity_params_default (&params);
+    
+    return wlc_rho_F_cavity_params (f, bB, JB, &params);
+}
 
-/* compute cavity elongation rho as a function of force F and the gradient. */
-/* This is also used to evaluate the susceptibility [Eq. (12), Massucci et al. (2014)] and the correlation length at fixed force [Eq. (13), Massucci et al. (2014)]*/
-double wlc_rho_F_cavity_and_gradient (double f, double bB, double JB, double * drho_dbB, double * drho_dJB, double * xi_f){
+/* compute cavity elongation rho as a function of force F, using the symmetry of the */
+/* marginal around the force axis to integrate analytically over phi */
+double wlc_rho_F_cavity_axisymmetric (double f, double bB, double JB){
+  
+    wlc_cavity_params params;
     
-    cavity_gradient_workspace *cav_w = (cavity_gradient_workspace *) cavity_gradient_workspace_alloc ();
-    int i = 0;
-    double *P, l=0., zeta_0=0., dl_dbB=0., dl_dJB=0., Z=0., dZ_dbB=0., dZ_dJB=0., integral, d_integral_dbB, d_integral_dJB, dZ, d_dZ_dbB, d_dZ_dJB, cos_theta;
+    wlc_cavity_params_default (&params);
+    params.axisymmetric = 1;
     
-    /* initialise the cavity workspace */
+    return wlc_rho_F_cavity_params (f, bB, JB, &params);
+}
 
-    cavity_gradient_workspace_initialise (cav_w);
 
+/* compute cavity elongation rho as a function of force F and the gradient on an initialised workspace. */
+/* This is also used to evaluate the susceptibility [Eq. (12), Massucci et al. (2014)] and the correlation length at fixed force [Eq. (13), Massucci et al. (2014)]*/
+double wlc_rho_F_cavity_and_gradient_workspace (cavity_gradient_workspace *cav_w, double f, double bB, double JB, double * drho_dbB, double * drho_dJB, double * xi_f){
+    
+    int i = 0;
+    double *P, l=0., zeta_0=0., dl_dbB=0., dl_dJB=0., Z=0., dZ_dbB=0., dZ_dJB=0., integral, d_integral_dbB, d_integral_dJB, dZ, d_dZ_dbB, d_dZ_dJB, cos_theta, field_w;
+    
     /*iterate cavity equations to get the exact cavity marginal*/
-    cavity_iterate_gradient_marginal_equations (cav_w, f, bB, JB);
+    if ((cav_w -> status = cavity_iterate_gradient_marginal_equations (cav_w, f, bB, JB))!=GSL_SUCCESS)
+        wlc_error ("wlc_rho_F_cavity_and_gradient: max_iter hit! f = %f\n", f);
+    
+    /* evaluate the integrals I(t) = exp(J * t*u) *P_c(u) with the kernel built by the iteration */
+    cavity_integrate_marginal_and_gradient_bB (cav_w, cav_w -> marginal, cav_w -> integral);
+    
+    /* and their gradient wrt the parameters bB, JB */
+    cavity_integrate_marginal_and_gradient_bB (cav_w, cav_w -> d_marginal_dbB, cav_w -> d_integral_dbB);
+    
+    cavity_integrate_gradient_JB_marginal (cav_w, cav_w -> marginal, cav_w -> d_marginal_dJB, cav_w -> d_integral_dJB);
     
     /* integrate z*t*P(t) over the unit sphere */
-    for (P= cav_w -> marginal; P< cav_w -> marginal+__Ntheta__*__Nphi__; P++){
+    for (P= cav_w -> marginal; P< cav_w -> marginal+cav_w -> npoints; P++){
         
-        /* evaluate the integral I(t) = exp(J * t*u) *P_c(u) */
-        integral = cavity_integrate_marginal_and_gradient_bB (cav_w, cav_w -> marginal, JB, i*__Ntheta__*__Nphi__);
+        integral = *(cav_w -> integral + i);
+        d_integral_dbB = *(cav_w -> d_integral_dbB + i);
+        d_integral_dJB = *(cav_w -> d_integral_dJB + i);
         
-        /* and its gradient wrt the parameters bB, JB */
-        d_integral_dbB = cavity_integrate_marginal_and_gradient_bB (cav_w, cav_w -> d_marginal_dbB, JB, i*__Ntheta__*__Nphi__);
+        cos_theta = *(cav_w -> cos_theta+ i/cav_w -> Nphi);
         
-        d_integral_dJB = cavity_integrate_gradient_JB_marginal (cav_w, cav_w -> marginal, cav_w -> d_marginal_dJB, JB, i*__Ntheta__*__Nphi__);
+        /* exp(b_B*f * t*z) times the quadrature weight */
+        field_w = *(cav_w -> field + i) * *(cav_w -> weight + i);
         
         /* get the elongation = t*z * exp(b_B*f * t*z) * I(t)^2, Eq. (11) of Massucci et al. 2014 */
         
-        dZ = exp(f* *(cav_w -> cos_theta+ i/__Nphi__)*bB) * integral*integral * *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__);
-        
-        d_dZ_dbB = exp(f* *(cav_w -> cos_theta+ i/__Nphi__)*bB)*integral * *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__) * ( *(cav_w -> cos_theta+ i/__Nphi__) * f * integral + 2. * d_integral_dbB) ;
+        dZ = field_w * integral*integral;
         
-        d_dZ_dJB = exp(f* *(cav_w -> cos_theta+ i/__Nphi__)*bB)*integral * *(cav_w -> w_cos_theta+ i/__Nphi__) * *(cav_w -> w_phi + i%__Nphi__) * 2. * d_integral_dJB;
+        d_dZ_dbB = field_w * integral * ( cos_theta * f * integral + 2. * d_integral_dbB) ;
         
-        cos_theta = *(cav_w -> cos_theta+ i/__Nphi__);
+        d_dZ_dJB = field_w * integral * 2. * d_integral_dJB;
         
         l +=  cos_theta * dZ;
         
@@ -417,6 +529,7 @@ double wlc_rho_F_cavity_and_gradient (double f, double bB, double JB, double * d
     
     cav_w -> dLdbB = dl_dbB;
     cav_w -> dLdJB = dl_dJB;
+    cav_w -> variance = zeta_0;
     
     /* And the correlation length at force f xi(f) [Eq. (13) of Massucci et al. 2014]*/
     
@@ -425,8 +538,88 @@ double wlc_rho_F_cavity_and_gradient (double f, double bB, double JB, double * d
     *drho_dbB = cav_w -> dLdbB;
     *drho_dJB = cav_w -> dLdJB;
     *xi_f = cav_w -> xi;
+    
+    return l;
+}
+
+/* compute cavity elongation rho as a function of force F and the gradient, with the given solver parameters */
+double wlc_rho_F_cavity_and_gradient_params (double f, double bB, double JB, double * drho_dbB, double * drho_dJB, double * xi_f, const wlc_cavity_params *params){
+    
+    cavity_gradient_workspace *cav_w = (cavity_gradient_workspace *) cavity_gradient_workspace_alloc (params);
+    double l;
+    
+    /* initialise the cavity workspace */
+
+    cavity_gradient_workspace_initialise (cav_w);
+    
+    l = wlc_rho_F_cavity_and_gradient_workspace (cav_w, f, bB, JB, drho_dbB, drho_dJB, xi_f);
 
     cavity_gradient_workspace_free (cav_w);
     
     return l;
 }
+
+/* compute cavity elongation rho as a function of force F and the gradient. */
+double wlc_rho_F_cavity_and_gradient (double f, double bB, double JB, double * drho_dbB, double * drho_dJB, double * xi_f){
+    
+    wlc_cavity_params params;
+    
+    wlc_cavity_params_default (&params);
+    
+    return wlc_rho_F_cavity_and_gradient_params (f, bB, JB, drho_dbB, drho_dJB, xi_f, &params);
+}
+
+/* compute cavity elongation rho as a function of force F and the gradient, */
+/* integrating analytically over phi the marginal symmetric around the force axis */
+double wlc_rho_F_cavity_and_gradient_axisymmetric (double f, double bB, double JB, double * drho_dbB, double * drho_dJB, double * xi_f){
+    
+    wlc_cavity_params params;
+    
+    wlc_cavity_params_default (&params);
+    params.axisymmetric = 1;
+    
+    return wlc_rho_F_cavity_and_gradient_params (f, bB, JB, drho_dbB, drho_dJB, xi_f, &params);
+}
+
+
+/* compute the cavity force-extension curve rho(f[k]) for the n forces f[k] */
+/* each force starts the iteration from the marginal converged at the previous one */
+void wlc_rho_F_cavity_curve (const double *f, size_t n, double bB, double JB, double *rho){
+    
+    wlc_cavity_params params;
+    wlc_cavity_solver *solver;
+    
+    wlc_cavity_params_default (&params);
+    solver = wlc_cavity_solver_alloc (&params);
+    
+    wlc_cavity_solver_rho_F_curve (solver, f, n, bB, JB, rho);
+    
+    wlc_cavity_solver_free (solver);
+}
+
+/* compute the cavity observables selected by mask at force f, with the given solver parameters */
+int wlc_cavity_observables_params (double f, double bB, double JB, unsigned int mask, wlc_cavity_observables *obs, const wlc_cavity_params *params){
+    
+    wlc_cavity_solver *solver = wlc_cavity_solver_alloc (params);
+    int status;
+    
+    status = wlc_cavity_solver_observables (solver, f, bB, JB, mask, obs);
+    
+    wlc_cavity_solver_free (solver);
+    
+    return status;
+}
+
+/* compute the cavity force-extension curve and its gradient for the n forces f[k] */
+void wlc_rho_F_cavity_and_gradient_curve (const double *f, size_t n, double bB, double JB, double *rho, double *drho_dbB, double *drho_dJB, double *xi_f){
+    
+    wlc_cavity_params params;
+    wlc_cavity_solver *solver;
+    
+    wlc_cavity_params_default (&params);
+    solver = wlc_cavity_solver_alloc (&params);
+    
+    wlc_cavity_solver_rho_F_and_gradient_curve (solver, f, n, bB, JB, rho, drho_dbB, drho_dJB, xi_f);
+    
+    wlc_cavity_solver_free (solver);
+}
@@ -73,11 +73,149 @@ int safe_realloc (unsigned int new_vector_size, double **vector);
 unsigned int read_data (FILE *f_in, unsigned int ncols, unsigned int *cols, double ***data);
 
 /* cavity routines for discrete models */
+
+/* convergence tests of the cavity iteration, to be combined in the criterion field of wlc_cavity_params */
+#define WLC_CAVITY_WEIGHTED 1
+#define WLC_CAVITY_OBSERVABLES 2
+
+/* parameters of the cavity solver */
+typedef struct {
+  int Ntheta;             /* number of Gauss-Legendre points in cos(theta) */
+  int Nphi;               /* number of Gauss-Legendre points in phi */
+  double tol;             /* tolerance on the change of the marginal between two iterations */
+  unsigned int max_iter;  /* maximum number of iterations of the cavity equations */
+  int criterion;          /* 0 to stop on the sum of the changes of the marginal, or WLC_CAVITY_WEIGHTED on their sum weighted by the quadrature, */
+                          /* WLC_CAVITY_OBSERVABLES on the change of rho and the relative change of Z (iteration of rho only), or both */
+  int axisymmetric;       /* if non-zero, integrate analytically over phi */
+  unsigned int anderson;  /* history window of the Anderson acceleration, 0 for the plain iteration */
+  int eigen;              /* if non-zero, obtain the marginal as the leading eigenvector of the transfer operator */
+  int implicit;           /* if non-zero, obtain the gradient from the converged marginal by implicit differentiation (GMRES) */
+  unsigned int block;     /* number of forces of a curve iterated together as a matrix product, 0 or 1 for one at a time */
+  int single;             /* if non-zero, store the kernel of rho in single precision (plain iteration only) */
+  int lean;               /* if non-zero, compute the kernel of rho by tiles on the fly instead of storing it (plain iteration of rho only: */
+                          /* the gradient, hence wlc_cavity_fit, still stores the kernel and the scalar products) */
+  int periodic;           /* if non-zero, use a uniform periodic grid in phi, on which the kernel of rho is applied by FFT (plain iteration only) */
+  int spectral;           /* if non-zero, solve the axisymmetric equations, for rho in a basis of Ntheta Legendre polynomials (plain iteration only) */
+  int lebedev;            /* number of points of a Lebedev grid on the sphere replacing the Ntheta x Nphi grid, 0 for the tensor grid */
+  int adaptive;           /* if non-zero, cluster the points in cos(theta) around the force axis as the force grows */
+  unsigned int multigrid; /* number of coarser grids (halving Ntheta and Nphi) on which the iteration of rho starts, 0 for none */
+} wlc_cavity_params;
+
+/* fill the parameters with the default values */
+void wlc_cavity_params_default (wlc_cavity_params *);
+
 /* elongation with the cavity method */
 double wlc_rho_F_cavity (double, double, double);
 
 /* elongation gradient and persistence length with the cavity method */
 double wlc_rho_F_cavity_and_gradient (double, double, double, double *, double *, double *);
 
+/* same as above, for a marginal symmetric around the force axis (phi integrated analytically) */
+double wlc_rho_F_cavity_axisymmetric (double, double, double);
+
+double wlc_rho_F_cavity_and_gradient_axisymmetric (double, double, double, double *, double *, double *);
+
+/* same as above, with the grid and the tolerance given by the parameters */
+double wlc_rho_F_cavity_params (double, double, double, const wlc_cavity_params *);
+
+double wlc_rho_F_cavity_and_gradient_params (double, double, double, double *, double *, double *, const wlc_cavity_params *);
+
+/* a cavity solver keeps the grid and the kernel between evaluations, */
+/* to be used when the cavity functions are called many times with the same parameters */
+typedef struct wlc_cavity_solver wlc_cavity_solver;
+
+wlc_cavity_solver *wlc_cavity_solver_alloc (const wlc_cavity_params *);
+
+void wlc_cavity_solver_free (wlc_cavity_solver *);
+
+double wlc_cavity_solver_rho_F (wlc_cavity_solver *, double, double, double);
+
+double wlc_cavity_solver_rho_F_and_gradient (wlc_cavity_solver *, double, double, double, double *, double *, double *);
+
+/* observables of the cavity method, obtained from a single solve: the mask is a combination of the flags */
+/* below, and only the selected fields are set (those of the gradient cost a solve of the gradient) */
+#define WLC_CAVITY_RHO 1
+#define WLC_CAVITY_DRHO_DBB 2
+#define WLC_CAVITY_DRHO_DJB 4
+#define WLC_CAVITY_VARIANCE 8
+#define WLC_CAVITY_XI 16
+#define WLC_CAVITY_FREE_ENERGY 32
+#define WLC_CAVITY_DRHO_DF 64
+
+typedef struct {
+  double rho;             /* elongation, <z*t> */
+  double drho_dbB;        /* gradient of rho wrt the parameters bB, JB */
+  double drho_dJB;
+  double variance;        /* variance of z*t, <(z*t)^2> - rho^2 */
+  double xi_f;            /* correlation length at fixed force */
+  double free_energy;     /* free energy per segment, in units of kT */
+  double drho_df;         /* derivative of rho wrt the force */
+} wlc_cavity_observables;
+
+/* return the status of the solve, as wlc_cavity_solver_status */
+int wlc_cavity_solver_observables (wlc_cavity_solver *, double, double, double, unsigned int, wlc_cavity_observables *);
+
+int wlc_cavity_observables_params (double, double, double, unsigned int, wlc_cavity_observables *, const wlc_cavity_params *);
+
+/* number of iterations of the cavity equations done by the last evaluation */
+unsigned int wlc_cavity_solver_iter (const wlc_cavity_solver *);
+
+/* GSL_SUCCESS, or GSL_CONTINUE if the last evaluation stopped at max_iter before converging */
+int wlc_cavity_solver_status (const wlc_cavity_solver *);
+
+/* free energy per segment (in units of kT) at the last force evaluated, from the leading eigenvalue of the transfer operator */
+double wlc_cavity_solver_free_energy (const wlc_cavity_solver *);
+
+/* force-extension curves: the solution at each force is the starting point of the next one */
+void wlc_cavity_solver_rho_F_curve (wlc_cavity_solver *, const double *, size_t, double, double, double *);
+
+void wlc_cavity_solver_rho_F_and_gradient_curve (wlc_cavity_solver *, const double *, size_t, double, double, double *, double *, double *, double *);
+
+void wlc_rho_F_cavity_curve (const double *, size_t, double, double, double *);
+
+void wlc_rho_F_cavity_and_gradient_curve (const double *, size_t, double, double, double *, double *, double *, double *);
+
+/* a table of the cavity elongation as a function of f*bB and JB, built with the solver, */
+/* interpolated in O(1) inside it and evaluated with the solver outside of it: */
+/* alloc (params, max of |f*bB|, min and max of JB, number of nodes along f*bB and JB, at least 2 each). */
+/* The evaluations outside of the table share its solver, hence a table is used by one thread at a time */
+typedef struct wlc_cavity_table wlc_cavity_table;
+
+wlc_cavity_table *wlc_cavity_table_alloc (const wlc_cavity_params *, double, double, double, size_t, size_t);
+
+void wlc_cavity_table_free (wlc_cavity_table *);
+
+/* estimate of the interpolation error, sampled at the centres of the cells: not a bound */
+double wlc_cavity_table_error (const wlc_cavity_table *);
+
+double wlc_cavity_table_rho_F (wlc_cavity_table *, double, double, double);
+
+double wlc_cavity_table_rho_F_and_gradient (wlc_cavity_table *, double, double, double, double *, double *);
+
+/* an opt-in LRU cache of evaluations, keyed on the exact bits of the arguments: */
+/* alloc (capacity, number of shards); the shards are locked independently, */
+/* so that a cache can be shared among threads with little contention */
+typedef struct wlc_cache wlc_cache;
+
+wlc_cache *wlc_cache_alloc (size_t, unsigned int);
+
+void wlc_cache_free (wlc_cache *);
+
+/* number of evaluations found in the cache (hits) and computed (misses) */
+void wlc_cache_stats (wlc_cache *, unsigned long *, unsigned long *);
+
+double wlc_rho_F_cavity_cached (wlc_cache *, double, double, double);
+
+double wlc_rho_F_cavity_and_gradient_cached (wlc_cache *, double, double, double, double *, double *, double *);
+
+double wlc_F_rho_cached (wlc_cache *, double, double);
+
+/* batches of independent points (f[k], bB[k], JB[k]), shared among nthreads threads: an OpenMP team when */
+/* compiled with --enable-openmp, a pool of POSIX threads otherwise (all available threads, or one per online */
+/* processor, if nthreads <= 0). params may be NULL for the default parameters */
+void wlc_rho_F_cavity_batch (const double *, const double *, const double *, size_t, double *, const wlc_cavity_params *, int);
+
+void wlc_rho_F_cavity_and_gradient_batch (const double *, const double *, const double *, size_t, double *, double *, double *, double *, const wlc_cavity_params *, int);
+
 
 #endif
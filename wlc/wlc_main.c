@@ -24,8 +24,8 @@
 #include "fit-models.h"
 
 void print_usage (const char *program_name) {
-  printf ("Usage: %s [-v] [-T <temperature>] <function> <function arguments>\n", program_name);
-  printf ("\tfunctions available: rho_F, F_rho, rho_F_cavity, rho_F_cavity_and_gradient\n");
+  printf ("Usage: %s [-v] [-T <temperature>] [-N <Ntheta>] [-P <Nphi>] [-E <tol>] [-M <max_iter>] [-C <criterion>] [-a] [-A <m>] [-e] [-I] [-s] [-L] [-p] [-S] [-l <n>] [-f] [-m <levels>] <function> <function arguments>\n", program_name);
+  printf ("\tfunctions available: rho_F, F_rho, rho_F_cavity, rho_F_cavity_and_gradient, cavity_observables, Marko_fit, cavity_fit\n");
 }
 
 void print_help () {
@@ -38,11 +38,30 @@ void print_help () {
   printf ("\n");
   printf ("Cavity theory formulae:\n");
   printf ("\trho_F_cavity <F> <bB> <JB>: the relative extension as a function of force\n");
+  printf ("\tcavity_observables <F> <bB> <JB>: rho, drho/dbB, drho/dJB, variance of z*t, xi_f, free energy and drho/dF from one solve\n");
+  printf ("\tcavity_fit <bB0> <JB0> <input_file>: fit (bB, JB) to columns force, relative extension, error\n");
   printf ("Options:\n");
   printf ("\t-v: verbose output\n");
   printf ("\t-h: print this help and exit\n");
   printf ("\t-T <temperature>: assign temperature in Kelvins\n");
   printf ("\t   (note: in this case all output will be given in pN or pN/nm)\n");
+  printf ("\t-N <Ntheta>: number of points in cos(theta) of the cavity grid\n");
+  printf ("\t-P <Nphi>: number of points in phi of the cavity grid\n");
+  printf ("\t-E <tol>: tolerance of the cavity iteration\n");
+  printf ("\t-M <max_iter>: maximum number of iterations of the cavity equations\n");
+  printf ("\t-C <criterion>: convergence test of the cavity iteration, 0 on the change of the marginal,\n");
+  printf ("\t   1 weighted by the quadrature, 2 on the error of rho and Z (rho_F_cavity only), 3 for both 1 and 2\n");
+  printf ("\t-a: use the axisymmetric cavity solver (phi integrated analytically)\n");
+  printf ("\t-A <m>: accelerate the cavity iteration with an Anderson history of m iterations\n");
+  printf ("\t-e: obtain the cavity marginal with the eigen-solver instead of the iteration\n");
+  printf ("\t-I: obtain the cavity gradient by implicit differentiation of the converged marginal\n");
+  printf ("\t-s: store the cavity kernel in single precision (rho_F_cavity only)\n");
+  printf ("\t-L: compute the cavity kernel on the fly instead of storing it, for large grids (rho_F_cavity only)\n");
+  printf ("\t-p: use a uniform periodic grid in phi, and FFT products with the kernel (rho_F_cavity only)\n");
+  printf ("\t-S: solve the axisymmetric cavity equations in a Legendre basis of Ntheta polynomials (rho_F_cavity only)\n");
+  printf ("\t-l <n>: replace the cavity grid by the Lebedev grid of n points (6, 14, 26, 38, 50, 86, 110, 146, 170 or 194)\n");
+  printf ("\t-f: cluster the points in cos(theta) of the cavity grid around the force axis as the force grows\n");
+  printf ("\t-m <levels>: start the cavity iteration on that many coarser grids, halving Ntheta and Nphi (rho_F_cavity only)\n");
   printf ("Note:\n");
   printf ("\t -- values of persistence length should be given in nm\n");
   printf ("\t -- all output is given in units of kT/nm, unless -T option provided\n");
@@ -51,6 +70,7 @@ void print_help () {
 int main (int argc, char *argv []) {
   int c, vflag = 0, Tflag = 0;
   double T;
+  wlc_cavity_params cavity_params;
   char *function_name;
   const char *program_name = "wlc";
 
@@ -60,8 +80,11 @@ int main (int argc, char *argv []) {
     exit (EXIT_FAILURE);
   }
 
+  /* default parameters of the cavity solver */
+  wlc_cavity_params_default (&cavity_params);
+
   /* parse command line options */
-  while ((c = getopt (argc, argv, "T:v::h::")) != -1) {
+  while ((c = getopt (argc, argv, "T:N:P:E:M:C:aA:eIsLpSl:fm:v::h::")) != -1) {
     switch (c) {
       case 'v' :
 	vflag = 1;
@@ -75,6 +98,54 @@ int main (int argc, char *argv []) {
 	Tflag = 1;
 	T = atof (optarg);
 	break;
+      case 'N' :
+	cavity_params.Ntheta = atoi (optarg);
+	break;
+      case 'P' :
+	cavity_params.Nphi = atoi (optarg);
+	break;
+      case 'E' :
+	cavity_params.tol = atof (optarg);
+	break;
+      case 'M' :
+	cavity_params.max_iter = atoi (optarg);
+	break;
+      case 'C' :
+	cavity_params.criterion = atoi (optarg);
+	break;
+      case 'a' :
+	cavity_params.axisymmetric = 1;
+	break;
+      case 'A' :
+	cavity_params.anderson = atoi (optarg);
+	break;
+      case 'e' :
+	cavity_params.eigen = 1;
+	break;
+      case 'I' :
+	cavity_params.implicit = 1;
+	break;
+      case 's' :
+	cavity_params.single = 1;
+	break;
+      case 'L' :
+	cavity_params.lean = 1;
+	break;
+      case 'p' :
+	cavity_params.periodic = 1;
+	break;
+      case 'S' :
+	cavity_params.spectral = 1;
+	break;
+      case 'l' :
+	cavity_params.lebedev = atoi (optarg);
+	break;
+      case 'f' :
+	cavity_params.adaptive = 1;
+	break;
+      case 'm' :
+	cavity_params.multigrid = atoi (optarg);
+	break;
       default :
 	print_usage (program_name);
 	exit (EXIT_FAILURE);
@@ -152,7 +223,7 @@ int main (int argc, char *argv []) {
     if (Tflag)
       F /= (K_BOLTZMANN*T*1.e14);
 
-    rho = wlc_rho_F_cavity (F, bB, JB);
+    rho = wlc_rho_F_cavity_params (F, bB, JB, &cavity_params);
 
     /* choose how output is given */
     if (vflag)
@@ -178,7 +249,7 @@ int main (int argc, char *argv []) {
     if (Tflag)
       F /= (K_BOLTZMANN*T*1.e14);
 
-    rho = wlc_rho_F_cavity_and_gradient (F, bB, JB, &drho_dbB, &drho_dJB, &xi_f);
+    rho = wlc_rho_F_cavity_and_gradient_params (F, bB, JB, &drho_dbB, &drho_dJB, &xi_f, &cavity_params);
 
     /* choose how output is given */
     if (vflag)
@@ -186,6 +257,33 @@ int main (int argc, char *argv []) {
     else
       printf ("%.5e\n", rho);
   }
+  else if (strcmp (function_name, "cavity_observables")==0) {
+    double JB, bB, F;
+    wlc_cavity_observables obs;
+
+    /* check that we have sufficient arguments */
+    if (optind+3>=argc) {
+      wlc_error ("Incorrect usage\n");
+      print_usage (program_name);
+      printf ("Usage: wlc [-v] cavity_observables <F> <bB> <JB>\n");
+      exit (EXIT_FAILURE);
+    }
+    /* if temperature was assigned, convert to pN */
+    F = atof (argv [optind+1]);
+    bB = atof (argv [optind+2]);
+    JB = atof (argv [optind+3]);
+
+    if (Tflag)
+      F /= (K_BOLTZMANN*T*1.e14);
+
+    wlc_cavity_observables_params (F, bB, JB, WLC_CAVITY_RHO | WLC_CAVITY_DRHO_DBB | WLC_CAVITY_DRHO_DJB | WLC_CAVITY_VARIANCE | WLC_CAVITY_XI | WLC_CAVITY_FREE_ENERGY | WLC_CAVITY_DRHO_DF, &obs, &cavity_params);
+
+    /* choose how output is given */
+    if (vflag)
+      printf ("F = %.5e bB = %.5e JB = %.5e drho_dbB = %.5e drho_dJB = %.5e variance = %.5e xi_f = %.5e free_energy = %.5e drho_dF = %.5e rho = %.5e\n", F, bB, JB, obs.drho_dbB, obs.drho_dJB, obs.variance, obs.xi_f, obs.free_energy, obs.drho_df, obs.rho);
+    else
+      printf ("%.5e %.5e %.5e %.5e %.5e %.5e %.5e\n", obs.rho, obs.drho_dbB, obs.drho_dJB, obs.variance, obs.xi_f, obs.free_energy, obs.drho_df);
+  }
   else if (strcmp (function_name, "Marko_fit")==0) {
     int fit_result;
     unsigned int i, n, cols [3];
@@ -236,6 +334,55 @@ int main (int argc, char *argv []) {
 
     return fit_result;
   }
+  else if (strcmp (function_name, "cavity_fit")==0) {
+    int fit_result;
+    unsigned int i, n, cols [3];
+    char *input_file;
+    double bB0, JB0;
+    double **data;
+    gsl_vector *x_init = gsl_vector_alloc (2);
+    FILE *f_in;
+
+    /* check that we have sufficient arguments */
+    if (optind+3>=argc) {
+      wlc_error ("Incorrect usage\n");
+      print_usage (program_name);
+      printf ("Usage: wlc cavity_fit <bB0> <JB0> <input_file>\n");
+      exit (EXIT_FAILURE);
+    }
+
+    /* get parameters */
+    bB0 = atof (argv [optind+1]);
+    JB0 = atof (argv [optind+2]);
+    input_file = argv [optind+3];
+
+    /* read data from input stream */
+    cols [0] = 0;
+    cols [1] = 1;
+    cols [2] = 2;
+    f_in = safe_fopen (input_file, "r");
+    n = read_data (f_in, 3, cols, &data);
+
+    /* if temperature was assigned, convert the forces from pN */
+    if (Tflag)
+      for (i=0; i<n; i++)
+	data[0][i] /= (K_BOLTZMANN*T*1.e14);
+
+    /* fit data to chosen model */
+    gsl_vector_set (x_init, 0, bB0);
+    gsl_vector_set (x_init, 1, JB0);
+    fit_result = wlc_cavity_fit (n, data[0], data[1], data[2], x_init, &cavity_params);
+
+    /* free memory */
+    free (data[0]);
+    free (data[1]);
+    free (data[2]);
+    free (data);
+    gsl_vector_free (x_init);
+    fclose (f_in);
+
+    return fit_result;
+  }
   else {
     wlc_error ("Incorrect usage\n");
     print_usage (program_name);